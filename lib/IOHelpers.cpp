@@ -20,25 +20,40 @@ void vecwrite(std::vector<uint8_t>& vec, void* data, size_t len)
 }
 
 std::vector<uint8_t> read_file_buffer(const std::filesystem::path& path)
+{
+    std::vector<uint8_t> b;
+    read_file_buffer(path, b);
+    return b;
+}
+
+bool read_file_buffer(const std::filesystem::path& path, std::vector<uint8_t>& out)
 {
     FILE* f = nullptr;
 
+    out.clear();
+
     if (fopen_s(&f, path.string().c_str(), "rb"))
     {
-        return {};
+        return false;
     }
 
     fseek(f, 0, SEEK_END);
     long len = ftell(f);
     fseek(f, 0, SEEK_SET);
 
-    std::vector<uint8_t> b;
-    b.resize(len);
+    if (len < 0)
+    {
+        fclose(f);
+        return false;
+    }
+
+    out.resize(len);
 
-    fread(b.data(), sizeof(uint8_t), len, f);
+    const size_t read = fread(out.data(), sizeof(uint8_t), len, f);
+    out.resize(read);
 
     fclose(f);
-    return b;
+    return true;
 }
 
 bool write_file_buffer(const std::filesystem::path& path, std::span<uint8_t> data)
@@ -58,46 +73,57 @@ bool write_file_buffer(const std::filesystem::path& path, std::span<uint8_t> dat
 
 std::vector<uint8_t> auto_decompress(std::vector<uint8_t>& vec, size_t initial_size)
 {
-    if (vec.size() < 2 || vec[0] != 0x1F && vec[1] != 0x8B)
+    std::vector<uint8_t> out_vec;
+    auto_decompress(vec, out_vec, initial_size);
+    return out_vec;
+}
+
+bool auto_decompress(std::span<const uint8_t> in, std::vector<uint8_t>& out, size_t initial_size)
+{
+    if (in.size() < 2 || in[0] != 0x1F && in[1] != 0x8B)
     {
-        // vec is decompressed already
+        // in is decompressed already
+        out.assign(in.begin(), in.end());
+        return true;
+    }
 
-        // we need a copy, not ref
-        std::vector<uint8_t> out_vec = vec;
-        return out_vec;
+    // The gzip trailer stores the decompressed size modulo 2^32. It comes from the file, so it's only trusted up to the size of the largest cartridge ROM.
+    constexpr size_t max_size_hint = 64 * 1024 * 1024;
+    size_t buf_size = std::max(initial_size, in.size());
+    if (in.size() >= 18)
+    {
+        uint32_t isize;
+        memcpy(&isize, in.data() + in.size() - sizeof(isize), sizeof(isize));
+        buf_size = std::max(buf_size, std::min(static_cast<size_t>(isize), max_size_hint));
     }
 
-    // we dont know what the decompressed size is, so we reallocate a buffer until we find the right size lol
-    size_t buf_size = initial_size;
-    auto out_buf = static_cast<uint8_t*>(malloc(buf_size));
-    auto decompressor = libdeflate_alloc_decompressor();
+    thread_local std::unique_ptr<libdeflate_decompressor, decltype(&libdeflate_free_decompressor)> decompressor(libdeflate_alloc_decompressor(), &libdeflate_free_decompressor);
+
+    // If the trailer lies, we reallocate the buffer until we find the right size
     while (true)
     {
-        out_buf = static_cast<uint8_t*>(realloc(out_buf, buf_size));
+        out.resize(buf_size);
         size_t actual_size = 0;
         auto result = libdeflate_gzip_decompress(
-        decompressor,
-        vec.data(),
-        vec.size(),
-        out_buf,
-        buf_size,
+        decompressor.get(),
+        in.data(),
+        in.size(),
+        out.data(),
+        out.size(),
         &actual_size);
         if (result == LIBDEFLATE_SHORT_OUTPUT || result == LIBDEFLATE_INSUFFICIENT_SPACE)
         {
             buf_size *= 2;
             continue;
         }
-        buf_size = actual_size;
-        break;
+        if (result != LIBDEFLATE_SUCCESS)
+        {
+            out.clear();
+            return false;
+        }
+        out.resize(actual_size);
+        return true;
     }
-    libdeflate_free_decompressor(decompressor);
-
-    out_buf = static_cast<uint8_t*>(realloc(out_buf, buf_size));
-    std::vector<uint8_t> out_vec;
-    out_vec.resize(buf_size);
-    memcpy(out_vec.data(), out_buf, buf_size);
-    free(out_buf);
-    return out_vec;
 }
 
 void memread(uint8_t** src, void* dest, unsigned int len)
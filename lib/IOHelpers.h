@@ -21,6 +21,14 @@ void vecwrite(std::vector<uint8_t>& vec, void* data, size_t len);
  */
 std::vector<uint8_t> read_file_buffer(const std::filesystem::path& path);
 
+/**
+ * \brief Reads a file into an existing buffer, reusing its capacity
+ * \param path The file's path
+ * \param out The buffer which receives the file's contents
+ * \return Whether the operation succeeded
+ */
+bool read_file_buffer(const std::filesystem::path& path, std::vector<uint8_t>& out);
+
 /**
  * \brief Writes a buffer to a file
  * \param path The file's path
@@ -37,6 +45,15 @@ bool write_file_buffer(const std::filesystem::path& path, std::span<uint8_t> dat
  */
 std::vector<uint8_t> auto_decompress(std::vector<uint8_t>& vec, size_t initial_size = 0xB624F0);
 
+/**
+ * \brief Decompresses an (optionally) gzip-compressed buffer into an existing buffer, reusing its capacity
+ * \param in The source buffer
+ * \param out The buffer which receives the decompressed data
+ * \param initial_size The initial size to try if the gzip trailer doesn't specify a usable size
+ * \return Whether the operation succeeded
+ */
+bool auto_decompress(std::span<const uint8_t> in, std::vector<uint8_t>& out, size_t initial_size = 0xB624F0);
+
 /**
  * \brief Reads source data into the destination, advancing the source pointer by <c>len</c>
  * \param src A pointer to the source data
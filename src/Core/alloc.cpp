@@ -13,7 +13,27 @@
 
 // https://github.com/mupen64plus/mupen64plus-core/blob/e170c409fb006aa38fd02031b5eefab6886ec125/src/device/r4300/recomp.c#L995
 
-void* malloc_exec(size_t size)
+// Recompiled code is bump-allocated from a single reserved region, which keeps it dense in the i-cache and TLB and avoids a VirtualAlloc round-trip per block.
+// Freeing is a no-op except for the most recent allocation, which is also the only one that can grow in place. Space is reclaimed by resetting the whole arena.
+
+// The granularity at which arena pages are committed.
+constexpr size_t EXEC_ARENA_COMMIT_SIZE = 0x100000;
+
+// The alignment of arena allocations.
+constexpr size_t EXEC_ARENA_ALIGNMENT = 16;
+
+static uint8_t* g_arena_base;
+static size_t g_arena_committed;
+static std::atomic<size_t> g_arena_top;
+static uint8_t* g_arena_last;
+static bool g_arena_full;
+
+static bool in_arena(const void* ptr)
+{
+    return g_arena_base && ptr >= g_arena_base && ptr < g_arena_base + EXEC_ARENA_SIZE;
+}
+
+static void* os_alloc_exec(const size_t size)
 {
 #ifdef WIN32
     return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
@@ -22,8 +42,64 @@ void* malloc_exec(size_t size)
 #endif
 }
 
+/**
+ * Makes sure the arena is reserved and committed up to the specified offset.
+ */
+static bool arena_ensure(const size_t end)
+{
+#ifdef WIN32
+    if (!g_arena_base)
+    {
+        g_arena_base = (uint8_t*)VirtualAlloc(NULL, EXEC_ARENA_SIZE, MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+        if (!g_arena_base)
+            return false;
+    }
+
+    if (end > g_arena_committed)
+    {
+        const size_t new_committed = std::min(EXEC_ARENA_SIZE, (end + EXEC_ARENA_COMMIT_SIZE - 1) / EXEC_ARENA_COMMIT_SIZE * EXEC_ARENA_COMMIT_SIZE);
+        if (!VirtualAlloc(g_arena_base + g_arena_committed, new_committed - g_arena_committed, MEM_COMMIT, PAGE_EXECUTE_READWRITE))
+            return false;
+        g_arena_committed = new_committed;
+    }
+    return true;
+#else
+#error "arena_ensure not implemented for this platform"
+#endif
+}
+
+static size_t align_up(const size_t size)
+{
+    return (size + EXEC_ARENA_ALIGNMENT - 1) & ~(EXEC_ARENA_ALIGNMENT - 1);
+}
+
+void* malloc_exec(size_t size)
+{
+    const size_t offset = g_arena_top;
+    if (size <= EXEC_ARENA_SIZE - offset && arena_ensure(offset + size))
+    {
+        g_arena_last = g_arena_base + offset;
+        g_arena_top = std::min(EXEC_ARENA_SIZE, offset + align_up(size));
+        return g_arena_last;
+    }
+
+    g_arena_full = true;
+    return os_alloc_exec(size);
+}
+
 void* realloc_exec(void* ptr, size_t oldsize, size_t newsize)
 {
+    // The most recent allocation can simply be extended
+    if (ptr && ptr == g_arena_last)
+    {
+        const size_t offset = g_arena_last - g_arena_base;
+        if (newsize <= EXEC_ARENA_SIZE - offset && arena_ensure(offset + newsize))
+        {
+            g_arena_top = std::min(EXEC_ARENA_SIZE, offset + align_up(newsize));
+            return ptr;
+        }
+    }
+
     void* block = malloc_exec(newsize);
     if (block != NULL)
     {
@@ -39,9 +115,36 @@ void* realloc_exec(void* ptr, size_t oldsize, size_t newsize)
 
 void free_exec(void* ptr)
 {
+    if (in_arena(ptr))
+    {
+        if (ptr == g_arena_last)
+        {
+            g_arena_top = g_arena_last - g_arena_base;
+            g_arena_last = nullptr;
+        }
+        return;
+    }
+
 #ifdef WIN32
     VirtualFree(ptr, 0, MEM_RELEASE);
 #else
 #error "free_exec not implemented for this platform"
 #endif
 }
+
+bool exec_arena_full()
+{
+    return g_arena_full;
+}
+
+size_t exec_arena_used()
+{
+    return g_arena_top;
+}
+
+void exec_arena_reset()
+{
+    g_arena_top = 0;
+    g_arena_last = nullptr;
+    g_arena_full = false;
+}
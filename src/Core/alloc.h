@@ -6,6 +6,26 @@
 
 #pragma once
 
+/**
+ * The size of the executable arena which recompiled code is allocated from. Allocations which don't fit fall back to individual executable allocations.
+ */
+constexpr size_t EXEC_ARENA_SIZE = 64 * 1024 * 1024;
+
 void* malloc_exec(size_t size);
 void* realloc_exec(void* ptr, size_t oldsize, size_t newsize);
 void free_exec(void* ptr);
+
+/**
+ * Gets whether an allocation didn't fit into the executable arena since the last reset, meaning that the code cache should be flushed.
+ */
+bool exec_arena_full();
+
+/**
+ * Gets the amount of bytes currently allocated from the executable arena.
+ */
+size_t exec_arena_used();
+
+/**
+ * Discards every allocation made from the executable arena. All pointers into the arena become invalid.
+ */
+void exec_arena_reset();
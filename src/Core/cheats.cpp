@@ -10,10 +10,23 @@
 #include <cheats.h>
 #include <r4300/r4300.h>
 
+// Guards the host list and the override stack. Only taken by mutators and readers outside of the emu thread.
 static std::recursive_mutex cheats_mutex;
 static std::vector<core_cheat> host_cheats;
 static std::stack<std::vector<core_cheat>> cheat_stack;
 
+// An immutable snapshot of the cheat list currently in effect, replaced whenever the host list or the override stack changes.
+// cht_execute runs on every input poll, so it only loads this pointer instead of contending with UI edits for the mutex.
+static std::atomic<std::shared_ptr<const std::vector<core_cheat>>> active_cheats;
+
+/**
+ * Publishes the cheat list currently in effect. Must be called with cheats_mutex held.
+ */
+static void publish_active_cheats()
+{
+    active_cheats.store(std::make_shared<const std::vector<core_cheat>>(cheat_stack.empty() ? host_cheats : cheat_stack.top()), std::memory_order_release);
+}
+
 bool core_cht_compile(const std::wstring& code, core_cheat& cheat)
 {
     core_cheat compiled_cheat{};
@@ -54,10 +67,7 @@ bool core_cht_compile(const std::wstring& code, core_cheat& cheat)
             {
                 // Madghostek: warning, assumes that serial codes are writing bytes, which seems to match pj64
                 // Madghostek: if not, change WB to WW
-                compiled_cheat.instructions.emplace_back(std::make_tuple(false, [=] {
-                    core_rdram_store<uint8_t>(rdramb, address + serial_offset * i, val + serial_diff * i);
-                    return true;
-                }));
+                compiled_cheat.instructions.push_back({(uint32_t)(address + serial_offset * i), (uint16_t)((val + serial_diff * i) & 0xFF), core_cheat_op_write_byte, false});
             }
             serial = false;
             continue;
@@ -66,68 +76,42 @@ bool core_cht_compile(const std::wstring& code, core_cheat& cheat)
         if (opcode == L"80" || opcode == L"A0")
         {
             // Write byte
-            compiled_cheat.instructions.emplace_back(std::make_tuple(false, [=] {
-                core_rdram_store<uint8_t>(rdramb, address, val & 0xFF);
-                return true;
-            }));
+            compiled_cheat.instructions.push_back({address, (uint16_t)(val & 0xFF), core_cheat_op_write_byte, false});
         }
         else if (opcode == L"81" || opcode == L"A1")
         {
             // Write word
-            compiled_cheat.instructions.emplace_back(std::make_tuple(false, [=] {
-                core_rdram_store<uint16_t>(rdramb, address, val);
-                return true;
-            }));
+            compiled_cheat.instructions.push_back({address, (uint16_t)val, core_cheat_op_write_half, false});
         }
         else if (opcode == L"88")
         {
             // Write byte if GS button pressed
-            compiled_cheat.instructions.emplace_back(std::make_tuple(false, [=] {
-                if (core_vr_get_gs_button())
-                {
-                    core_rdram_store<uint8_t>(rdramb, address, val & 0xFF);
-                }
-                return true;
-            }));
+            compiled_cheat.instructions.push_back({address, (uint16_t)(val & 0xFF), core_cheat_op_write_byte_gs, false});
         }
         else if (opcode == L"89")
         {
             // Write word if GS button pressed
-            compiled_cheat.instructions.emplace_back(std::make_tuple(false, [=] {
-                if (core_vr_get_gs_button())
-                {
-                    core_rdram_store<uint16_t>(rdramb, address, val);
-                }
-                return true;
-            }));
+            compiled_cheat.instructions.push_back({address, (uint16_t)val, core_cheat_op_write_half_gs, false});
         }
         else if (opcode == L"D0")
         {
             // Byte equality comparison
-            compiled_cheat.instructions.emplace_back(std::make_tuple(true, [=] {
-                return core_rdram_load<uint8_t>(rdramb, address) == (val & 0xFF);
-            }));
+            compiled_cheat.instructions.push_back({address, (uint16_t)(val & 0xFF), core_cheat_op_byte_equal, true});
         }
         else if (opcode == L"D1")
         {
             // Word equality comparison
-            compiled_cheat.instructions.emplace_back(std::make_tuple(true, [=] {
-                return core_rdram_load<uint16_t>(rdramb, address) == val;
-            }));
+            compiled_cheat.instructions.push_back({address, (uint16_t)val, core_cheat_op_half_equal, true});
         }
         else if (opcode == L"D2")
         {
             // Byte inequality comparison
-            compiled_cheat.instructions.emplace_back(std::make_tuple(true, [=] {
-                return core_rdram_load<uint8_t>(rdramb, address) != (val & 0xFF);
-            }));
+            compiled_cheat.instructions.push_back({address, (uint16_t)(val & 0xFF), core_cheat_op_byte_not_equal, true});
         }
         else if (opcode == L"D3")
         {
             // Word inequality comparison
-            compiled_cheat.instructions.emplace_back(std::make_tuple(true, [=] {
-                return core_rdram_load<uint16_t>(rdramb, address) != val;
-            }));
+            compiled_cheat.instructions.push_back({address, (uint16_t)val, core_cheat_op_half_not_equal, true});
         }
         else if (opcode == L"50")
         {
@@ -144,7 +128,11 @@ bool core_cht_compile(const std::wstring& code, core_cheat& cheat)
         }
     }
 
+    compiled_cheat.instructions.shrink_to_fit();
     compiled_cheat.code = code;
+
+    g_core->log_info(std::format(L"[GS] Compiled {} instructions ({} bytes)", compiled_cheat.instructions.size(), compiled_cheat.instructions.size() * sizeof(core_cheat_instruction)));
+
     cheat = compiled_cheat;
 
     return true;
@@ -238,9 +226,9 @@ void core_cht_get_override_stack(std::stack<std::vector<core_cheat>>& stack)
 
 void core_cht_get_list(std::vector<core_cheat>& list)
 {
-    std::scoped_lock lock(cheats_mutex);
+    const auto cheats = active_cheats.load(std::memory_order_acquire);
 
-    list = cheat_stack.empty() ? host_cheats : cheat_stack.top();
+    list = cheats ? *cheats : std::vector<core_cheat>{};
 }
 
 void core_cht_set_list(const std::vector<core_cheat>& list)
@@ -254,6 +242,7 @@ void core_cht_set_list(const std::vector<core_cheat>& list)
     }
 
     host_cheats = list;
+    publish_active_cheats();
 }
 
 void cht_layer_push(const std::vector<core_cheat>& cheats)
@@ -263,6 +252,7 @@ void cht_layer_push(const std::vector<core_cheat>& cheats)
     g_core->log_info(std::format(L"cht_layer_push pushing {} cheats", cheats.size()));
 
     cheat_stack.push(cheats);
+    publish_active_cheats();
 }
 
 void cht_layer_pop()
@@ -270,15 +260,57 @@ void cht_layer_pop()
     std::scoped_lock lock(cheats_mutex);
 
     cheat_stack.pop();
+    publish_active_cheats();
+}
+
+/**
+ * Executes a single compiled instruction.
+ * \return Whether the following instructions should be executed.
+ */
+static bool execute_instruction(const core_cheat_instruction& instruction)
+{
+    switch (instruction.op)
+    {
+    case core_cheat_op_write_byte:
+        core_rdram_store<uint8_t>(rdramb, instruction.address, (uint8_t)instruction.value);
+        return true;
+    case core_cheat_op_write_half:
+        core_rdram_store<uint16_t>(rdramb, instruction.address, instruction.value);
+        return true;
+    case core_cheat_op_write_byte_gs:
+        if (core_vr_get_gs_button())
+        {
+            core_rdram_store<uint8_t>(rdramb, instruction.address, (uint8_t)instruction.value);
+        }
+        return true;
+    case core_cheat_op_write_half_gs:
+        if (core_vr_get_gs_button())
+        {
+            core_rdram_store<uint16_t>(rdramb, instruction.address, instruction.value);
+        }
+        return true;
+    case core_cheat_op_byte_equal:
+        return core_rdram_load<uint8_t>(rdramb, instruction.address) == instruction.value;
+    case core_cheat_op_half_equal:
+        return core_rdram_load<uint16_t>(rdramb, instruction.address) == instruction.value;
+    case core_cheat_op_byte_not_equal:
+        return core_rdram_load<uint8_t>(rdramb, instruction.address) != instruction.value;
+    case core_cheat_op_half_not_equal:
+        return core_rdram_load<uint16_t>(rdramb, instruction.address) != instruction.value;
+    }
+    return true;
 }
 
 void cht_execute()
 {
-    std::scoped_lock lock(cheats_mutex);
+    const auto cheats = active_cheats.load(std::memory_order_acquire);
 
-    const auto& cheats = cheat_stack.empty() ? host_cheats : cheat_stack.top();
+    if (!cheats)
+    {
+        return;
+    }
 
-    for (const auto& cheat : cheats)
+    for (const auto& cheat : *cheats)
     {
         if (!cheat.active)
         {
@@ -286,13 +318,13 @@ void cht_execute()
         }
 
         bool execute = true;
-        for (auto instruction : cheat.instructions)
+        for (const auto& instruction : cheat.instructions)
         {
             if (execute)
             {
-                execute = std::get<1>(instruction)();
+                execute = execute_instruction(instruction);
             }
-            else if (!std::get<0>(instruction))
+            else if (!instruction.conditional)
             {
                 execute = true;
             }
@@ -206,6 +206,11 @@ typedef struct {
      */
     std::filesystem::path (*get_backups_directory)(void);
 
+    /**
+     * \brief Gets the directory in which the core can persist cached data, such as normalized ROM images.
+     */
+    std::filesystem::path (*get_cache_directory)(void);
+
     /**
      * \brief Gets the path to the summercart directory.
      */
@@ -295,11 +300,6 @@ typedef struct {
 #pragma region Core-Provided
     core_controller controls[4];
 
-    core_timer_delta g_frame_deltas[core_timer_max_deltas];
-    std::mutex g_frame_deltas_mutex;
-    core_timer_delta g_vi_deltas[core_timer_max_deltas];
-    std::mutex g_vi_deltas_mutex;
-
     uint8_t* rom;
     uint32_t* rdram;
     core_rdram_reg* rdram_register;
@@ -470,6 +470,20 @@ EXPORT std::wstring CALL core_vr_country_code_to_country_name(uint16_t country_c
  */
 EXPORT void CALL core_vr_on_speed_modifier_changed();
 
+/**
+ * \brief Gets a consistent snapshot of the most recent frame deltas.
+ * \param deltas The array to fill with the deltas. Unfilled slots are zero.
+ * \remarks Never blocks the emu thread. Safe to call from any thread.
+ */
+EXPORT void CALL core_vr_get_frame_deltas(core_timer_deltas& deltas);
+
+/**
+ * \brief Gets a consistent snapshot of the most recent VI deltas.
+ * \param deltas The array to fill with the deltas. Unfilled slots are zero.
+ * \remarks Never blocks the emu thread. Safe to call from any thread.
+ */
+EXPORT void CALL core_vr_get_vi_deltas(core_timer_deltas& deltas);
+
 /**
  * \brief Invalidates the visuals, allowing an updateScreen call to happen.
  */
@@ -486,6 +500,17 @@ EXPORT bool CALL core_vr_get_mge_available();
  */
 EXPORT void CALL core_vr_recompile(uint32_t addr);
 
+/**
+ * \brief Gets the occupancy and flush count of the dynarec's code cache.
+ */
+EXPORT core_code_cache_stats CALL core_vr_get_code_cache_stats();
+
+/**
+ * \brief Gets the recompilation counts of all pages which have been recompiled since the core started, sorted by descending count.
+ * \param pages The vector to fill with the pages.
+ */
+EXPORT void CALL core_vr_get_recompile_counts(std::vector<core_page_recompiles>& pages);
+
 #pragma endregion
 
 #pragma region VCR
@@ -506,6 +531,14 @@ EXPORT core_result CALL core_vcr_parse_header(std::filesystem::path path, core_v
  */
 EXPORT core_result CALL core_vcr_read_movie_inputs(std::filesystem::path path, std::vector<core_buttons>& inputs);
 
+/**
+ * \brief Losslessly converts a movie between the m64 and the compressed m64z format.
+ * \param path The source movie's path. The format is determined by the extension.
+ * \param out_path The converted movie's path. Must have the other format's extension.
+ * \return The operation result
+ */
+EXPORT core_result CALL core_vcr_convert_movie(const std::filesystem::path& path, const std::filesystem::path& out_path);
+
 /**
  * \brief Starts playing back a movie
  * \param path The movie's path
@@ -545,6 +578,9 @@ EXPORT void CALL core_vcr_get_seek_completion(std::pair<size_t, size_t>& pair);
  * \return The operation result
  * \remarks When the seek operation completes, the SeekCompleted message will be sent
  *
+ * Seeking backwards loads the closest seek savestate before the target frame. Seek savestates which can't be reconstructed are discarded in favor of older ones.
+ * If none is usable, playback replays the movie from the start, while recording fails with VCR_SeekSavestateLoadFailed.
+ *
  * Seek string format possibilities:
  *	"n" - Frame
  *	"+n", "-n" - Relative to current sample
@@ -673,6 +709,12 @@ EXPORT void CALL core_vcr_get_seek_savestate_frames(std::unordered_map<size_t, b
  */
 EXPORT bool CALL core_vcr_has_seek_savestate_at_frame(size_t frame);
 
+/**
+ * Gets the amount of memory occupied by the seek savestates in bytes.
+ * Seek savestates are stored as page-level deltas against a single full base savestate, so this is usually far less than the sum of the individual savestate sizes.
+ */
+EXPORT size_t CALL core_vcr_get_seek_savestate_resident_bytes();
+
 #pragma endregion
 
 #pragma region Tracelog
@@ -684,11 +726,50 @@ EXPORT bool CALL core_vcr_has_seek_savestate_at_frame(size_t frame);
  */
 EXPORT void CALL core_tl_start(std::filesystem::path path, bool binary, bool append);
 
+/**
+ * \brief Starts trace logging to the specified file.
+ * \param path The output path.
+ * \param options The tracing options.
+ * \return The operation result.
+ */
+EXPORT core_result CALL core_tl_start_ex(std::filesystem::path path, const core_tl_options& options);
+
 /**
  * \brief Stops trace logging.
  */
 EXPORT void CALL core_tl_stop();
 
+/**
+ * \brief Converts a binary_v2 trace into the text format.
+ * \param path The binary_v2 trace's path.
+ * \param out_path The output path.
+ * \return The operation result.
+ */
+EXPORT core_result CALL core_tl_decode(const std::filesystem::path& path, const std::filesystem::path& out_path);
+
+/**
+ * \brief Measures how fast FPU-heavy instructions are formatted for the text tracelog, with both the previous sprintf-based float formatter and the current one.
+ * \param count The amount of instructions to format per run.
+ */
+EXPORT core_tl_benchmark_result CALL core_tl_benchmark_text(size_t count);
+
+#pragma endregion
+
+#pragma region Performance
+
+/**
+ * \brief Gets a summary of a performance histogram's samples since it was last reset.
+ * \param metric The metric to summarize.
+ * \remarks Safe to call from any thread while the emulator is running.
+ */
+EXPORT core_perf_summary CALL core_perf_get_summary(core_perf_metric metric);
+
+/**
+ * \brief Resets a performance histogram, starting a new window.
+ * \param metric The metric to reset, or core_perf_metric_count to reset all metrics.
+ */
+EXPORT void CALL core_perf_reset(core_perf_metric metric);
+
 #pragma endregion
 
 #pragma region Savestates
@@ -720,6 +801,29 @@ EXPORT bool CALL core_st_do_memory(const std::vector<uint8_t>& buffer, core_st_j
  */
 EXPORT void CALL core_st_get_undo_savestate(std::vector<uint8_t>& buffer);
 
+/**
+ * Blocks until all pending savestate file writes to the specified path have completed.
+ * \param path The savestate's path. If empty, waits for all pending writes.
+ * \remarks Savestate files are written in the background, so this must be called before reading a just-saved file by other means.
+ */
+EXPORT void CALL core_st_wait_for_writes(const std::filesystem::path& path);
+
+/**
+ * Reads a single section from a savestate file without decoding the rest of the savestate.
+ * \param path The savestate's path.
+ * \param section The section to read.
+ * \param buffer The section's data.
+ * \return The operation result. Legacy savestates aren't sectioned, so this function fails with <c>ST_SectionNotFound</c> for them.
+ * \remarks This function doesn't interact with the savestate task queue and can be called from any thread.
+ */
+EXPORT core_result CALL core_st_read_section(const std::filesystem::path& path, core_st_section section, std::vector<uint8_t>& buffer);
+
+/**
+ * Gets the amount of times a savestate buffer had to be allocated or grown since startup.
+ * \remarks Savestate buffers are reused, so this value stops increasing once saving and loading reach a steady state.
+ */
+EXPORT uint64_t CALL core_st_get_allocation_count();
+
 #pragma endregion
 
 #pragma region Debugger
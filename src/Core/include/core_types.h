@@ -89,6 +89,19 @@ typedef enum {
     ST_EventQueueTooLong,
     // The CPU registers contained invalid values
     ST_InvalidRegisters,
+    // The savestate doesn't contain the requested section
+    ST_SectionNotFound,
+    // A savestate section's checksum didn't match its contents
+    ST_ChecksumMismatch,
+#pragma endregion
+
+#pragma region Tracelog
+    // The trace file couldn't be opened
+    TL_FileOpenFailed,
+    // The trace file has an invalid format
+    TL_InvalidFormat,
+    // A trace chunk couldn't be decompressed
+    TL_DecompressionError,
 #pragma endregion
 
 #pragma region Plugins
@@ -142,7 +155,7 @@ struct core_cfg {
     int32_t fastforward_silent;
 
     /// <summary>
-    /// Maximum number of entries into the rom cache
+    /// Maximum number of normalized ROMs kept in the on-disk rom cache
     /// <para/>
     /// 0 = disabled
     /// </summary>
@@ -206,7 +219,12 @@ struct core_cfg {
     /// <summary>
     /// The maximum amount of warp modify savestates to keep in memory
     /// </summary>
-    int32_t seek_savestate_max_count = 20;
+    int32_t seek_savestate_max_count = 1000;
+
+    /// <summary>
+    /// The maximum amount of memory in megabytes which warp modify savestates can occupy
+    /// </summary>
+    int32_t seek_savestate_max_resident_mb = 1024;
 
     /// <summary>
     /// The movie frame to automatically pause at
@@ -255,12 +273,71 @@ struct core_cfg {
     /// Throttles game rendering to 60 FPS.
     /// </summary>
     int32_t render_throttling = 1;
+
+    /// <summary>
+    /// How save media (EEPROM, SRAM, FlashRAM and mempak) files are accessed while a ROM is running
+    /// <para/>
+    /// 0 - Buffered, contents are written back to the files periodically
+    /// 1 - Memory-mapped, the files are mapped and flushed by the OS
+    /// </summary>
+    int32_t save_media_backend;
 };
 
 #pragma region Emulator
 
+typedef struct {
+    // The size of the dynarec's code cache in bytes.
+    size_t capacity;
+    // The amount of bytes currently occupied by recompiled code.
+    size_t used;
+    // The amount of times the code cache ran full and was flushed.
+    size_t flushes;
+} core_code_cache_stats;
+
+typedef struct {
+    // The start address of the page.
+    uint32_t address;
+    // The amount of times code in the page was recompiled.
+    uint32_t recompiles;
+} core_page_recompiles;
+
 typedef std::common_type_t<std::chrono::duration<int64_t, std::ratio<1, 1000000000>>, std::chrono::duration<int64_t, std::ratio<1, 1000000000>>> core_timer_delta;
 constexpr uint8_t core_timer_max_deltas = 60;
+typedef std::array<core_timer_delta, core_timer_max_deltas> core_timer_deltas;
+
+/**
+ * \brief A timing metric recorded by the performance histograms.
+ */
+typedef enum {
+    // The time between two frames.
+    core_perf_frame,
+    // The time between two VIs, excluding time spent sleeping to throttle the emulation speed.
+    core_perf_vi,
+    // The absolute difference between the requested and actual sleep duration when throttling.
+    core_perf_sleep_error,
+    // The time spent in the host's screen update, including the video plugin's UpdateScreen.
+    core_perf_update_screen,
+    // The time spent in the RSP plugin's DoRspCycles.
+    core_perf_rsp,
+    // The time spent in the audio plugin's AiLenChanged.
+    core_perf_ai_len_changed,
+    core_perf_metric_count,
+} core_perf_metric;
+
+/**
+ * \brief A summary of a performance histogram's current window.
+ * \remarks Percentiles are accurate to within roughly 2%.
+ */
+typedef struct {
+    // The amount of samples recorded.
+    uint64_t count;
+    // The percentiles in milliseconds.
+    double p50;
+    double p99;
+    double p999;
+    // The largest sample in milliseconds.
+    double max;
+} core_perf_summary;
 
 typedef struct {
     uint32_t rdram_config;
@@ -686,8 +763,112 @@ typedef struct
 
 #pragma endregion
 
+#pragma region Tracelog
+
+/**
+ * \brief The output format of the tracelog.
+ */
+typedef enum {
+    // Text, one disassembled instruction per line.
+    core_tl_format_text,
+    // Fixed 16-byte records of the PC, the opcode and two operand values.
+    core_tl_format_binary,
+    // Compact records with delta-encoded PCs and a per-chunk opcode dictionary. Can be converted to text with core_tl_decode.
+    core_tl_format_binary_v2,
+} core_tl_format;
+
+/**
+ * \brief Instruction classes which can be selected for tracing.
+ */
+typedef enum {
+    // Loads and stores, including COP1 loads and stores.
+    core_tl_class_load_store = 1 << 0,
+    // Jumps and branches.
+    core_tl_class_branch = 1 << 1,
+    // COP1 instructions.
+    core_tl_class_cop1 = 1 << 2,
+    // Everything else.
+    core_tl_class_other = 1 << 3,
+    core_tl_class_all = core_tl_class_load_store | core_tl_class_branch | core_tl_class_cop1 | core_tl_class_other,
+} core_tl_class;
+
+/**
+ * \brief Describes which instructions are traced. Instructions rejected by the PC range or class mask aren't instrumented at all.
+ */
+typedef struct {
+    // The first traced address.
+    uint32_t pc_start = 0;
+    // The last traced address.
+    uint32_t pc_end = UINT32_MAX;
+    // The traced instruction classes, as a combination of core_tl_class flags.
+    uint32_t classes = core_tl_class_all;
+    // The first traced VCR sample. If the window isn't the full range, nothing is traced while no movie is active.
+    size_t frame_start = 0;
+    // The last traced VCR sample.
+    size_t frame_end = SIZE_MAX;
+} core_tl_filter;
+
+/**
+ * \brief Options for a trace logging session.
+ */
+typedef struct {
+    // The output format.
+    core_tl_format format = core_tl_format_text;
+    // Whether binary_v2 chunks are compressed with deflate.
+    bool compress = false;
+    // The instructions to trace.
+    core_tl_filter filter;
+} core_tl_options;
+
+/**
+ * \brief The result of a text tracelog formatting benchmark.
+ */
+typedef struct {
+    // Instructions formatted per second with the sprintf-based float formatter.
+    double sprintf_ips;
+    // Instructions formatted per second with the current float formatter.
+    double ips;
+} core_tl_benchmark_result;
+
+#pragma endregion
+
 #pragma region Cheats
 
+/**
+ * \brief The operation performed by a compiled cheat instruction.
+ */
+typedef enum : uint8_t {
+    // Writes a byte.
+    core_cheat_op_write_byte,
+    // Writes a halfword.
+    core_cheat_op_write_half,
+    // Writes a byte if the GS button is pressed.
+    core_cheat_op_write_byte_gs,
+    // Writes a halfword if the GS button is pressed.
+    core_cheat_op_write_half_gs,
+    // Continues if a byte equals the value.
+    core_cheat_op_byte_equal,
+    // Continues if a halfword equals the value.
+    core_cheat_op_half_equal,
+    // Continues if a byte doesn't equal the value.
+    core_cheat_op_byte_not_equal,
+    // Continues if a halfword doesn't equal the value.
+    core_cheat_op_half_not_equal,
+} core_cheat_op;
+
+/**
+ * \brief A compiled cheat instruction.
+ */
+typedef struct {
+    // The RDRAM address operated on.
+    uint32_t address;
+    // The value written or compared against.
+    uint16_t value;
+    core_cheat_op op;
+    // Whether the instruction is a conditional, which is required for special handling of buggy kaze blj anywhere code.
+    bool conditional;
+} core_cheat_instruction;
+
 /**
  * \brief Represents a cheat.
  */
@@ -701,8 +882,8 @@ typedef struct CoreCheat {
     // Whether the cheat is active.
     bool active = true;
 
-    // The cheat's instructions. The pair's 1st element tells us whether instruction is a conditional, which is required for special handling of buggy kaze blj anywhere code
-    std::vector<std::tuple<bool, std::function<bool()>>> instructions;
+    // The cheat's compiled instructions.
+    std::vector<core_cheat_instruction> instructions;
 } core_cheat;
 
 #pragma endregion
@@ -723,6 +904,24 @@ typedef enum {
     core_st_medium_memory,
 } core_st_medium;
 
+typedef enum {
+    // The CPU, COP0, COP1 and RCP registers, PIF RAM and FlashRAM state.
+    core_st_section_registers,
+    // The contents of RDRAM.
+    core_st_section_rdram,
+    // The contents of SP DMEM and IMEM.
+    core_st_section_sp_memory,
+    // The TLB read and write lookup tables.
+    core_st_section_tlb_luts,
+    // The interrupt event queue.
+    core_st_section_event_queue,
+    // The VCR freeze buffer. Empty if no movie was active.
+    core_st_section_vcr_freeze,
+    // The screen contents. Empty if no screenshot was taken.
+    core_st_section_screenshot,
+    core_st_section_count,
+} core_st_section;
+
 struct core_st_job_params {
     /// The path to the savestate file.
     /// Valid if the task's medium is <see cref="e_st_medium::path"/>.
@@ -9,6 +9,7 @@
 #include "flashram.h"
 #include "memory.h"
 #include "pif.h"
+#include "save_media.h"
 #include "savestates.h"
 #include "summercart.h"
 #include <Core.h>
@@ -29,14 +30,12 @@ void dma_pi_read()
     {
         if (use_flashram != 1)
         {
-            fseek(g_sram_file, 0, SEEK_SET);
-            fread(sram, 1, 0x8000, g_sram_file);
+            save_media_read(save_media_sram, sram, sizeof(sram));
 
             for (i = 0; i < (pi_register.pi_rd_len_reg & 0xFFFFFF) + 1; i++)
                 sram[((pi_register.pi_cart_addr_reg - 0x08000000) + i) ^ S8] = ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg + i) ^ S8];
 
-            fseek(g_sram_file, 0, SEEK_SET);
-            fwrite(sram, 1, 0x8000, g_sram_file);
+            save_media_write(save_media_sram, sram, sizeof(sram));
             use_flashram = -1;
         }
         else
@@ -95,8 +94,7 @@ void dma_pi_write()
         {
             if (use_flashram != 1)
             {
-                fseek(g_sram_file, 0, SEEK_SET);
-                fread(sram, 1, 0x8000, g_sram_file);
+                save_media_read(save_media_sram, sram, sizeof(sram));
 
                 for (i = 0; i < (pi_register.pi_wr_len_reg & 0xFFFFFF) + 1; i++)
                     ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg + i) ^ S8] =
@@ -173,13 +171,8 @@ void dma_pi_write()
             ? 0xFF
             : rom[(((pi_register.pi_cart_addr_reg - 0x10000000) & 0x3FFFFFF) + i) ^ S8];
 
-            if (!invalid_code[rdram_address1 >> 12])
-                if (blocks[rdram_address1 >> 12]->block[(rdram_address1 & 0xFFF) / 4].ops != NOTCOMPILED)
-                    invalid_code[rdram_address1 >> 12] = 1;
-
-            if (!invalid_code[rdram_address2 >> 12])
-                if (blocks[rdram_address2 >> 12]->block[(rdram_address2 & 0xFFF) / 4].ops != NOTCOMPILED)
-                    invalid_code[rdram_address2 >> 12] = 1;
+            invalidate_code(rdram_address1);
+            invalidate_code(rdram_address2);
         }
     }
     else
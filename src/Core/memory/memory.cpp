@@ -17,6 +17,7 @@
 #include <r4300/r4300.h>
 #include <r4300/recomph.h>
 #include <r4300/timers.h>
+#include <r4300/perf.h>
 #include <r4300/vcr.h>
 
 static int32_t frame;
@@ -1212,7 +1213,7 @@ void update_SP()
             g_vr_frame_skipped = is_frame_skipped();
             if (!g_vr_frame_skipped)
             {
-                g_core->plugin_funcs.rsp_do_rsp_cycles(100);
+                perf_measure(core_perf_rsp, [] { g_core->plugin_funcs.rsp_do_rsp_cycles(100); });
             }
 
             rsp_register.rsp_pc |= save_pc;
@@ -1290,7 +1291,7 @@ void update_SP()
 
             if (!g_vr_fast_forward || !g_core->cfg->fastforward_silent)
             {
-                g_core->plugin_funcs.rsp_do_rsp_cycles(100);
+                perf_measure(core_perf_rsp, [] { g_core->plugin_funcs.rsp_do_rsp_cycles(100); });
             }
             rsp_register.rsp_pc |= save_pc;
 
@@ -1306,7 +1307,7 @@ void update_SP()
             rsp_register.rsp_pc &= 0xFFF;
             if (!g_vr_fast_forward || !g_core->cfg->fastforward_silent)
             {
-                g_core->plugin_funcs.rsp_do_rsp_cycles(100);
+                perf_measure(core_perf_rsp, [] { g_core->plugin_funcs.rsp_do_rsp_cycles(100); });
             }
             rsp_register.rsp_pc |= save_pc;
 
@@ -1431,9 +1432,8 @@ void read_nomemd()
 
 void write_nomem()
 {
-    if (!interpcore && !invalid_code[address >> 12])
-        if (blocks[address >> 12]->block[(address & 0xFFF) / 4].ops != NOTCOMPILED)
-            invalid_code[address >> 12] = 1;
+    if (!interpcore)
+        invalidate_code(address);
     address = virtual_to_physical_address(address, 1);
     if (address == 0x00000000)
         return;
@@ -1442,9 +1442,8 @@ void write_nomem()
 
 void write_nomemb()
 {
-    if (!interpcore && !invalid_code[address >> 12])
-        if (blocks[address >> 12]->block[(address & 0xFFF) / 4].ops != NOTCOMPILED)
-            invalid_code[address >> 12] = 1;
+    if (!interpcore)
+        invalidate_code(address);
     address = virtual_to_physical_address(address, 1);
     if (address == 0x00000000)
         return;
@@ -1453,9 +1452,8 @@ void write_nomemb()
 
 void write_nomemh()
 {
-    if (!interpcore && !invalid_code[address >> 12])
-        if (blocks[address >> 12]->block[(address & 0xFFF) / 4].ops != NOTCOMPILED)
-            invalid_code[address >> 12] = 1;
+    if (!interpcore)
+        invalidate_code(address);
     address = virtual_to_physical_address(address, 1);
     if (address == 0x00000000)
         return;
@@ -1464,9 +1462,8 @@ void write_nomemh()
 
 void write_nomemd()
 {
-    if (!interpcore && !invalid_code[address >> 12])
-        if (blocks[address >> 12]->block[(address & 0xFFF) / 4].ops != NOTCOMPILED)
-            invalid_code[address >> 12] = 1;
+    if (!interpcore)
+        invalidate_code(address);
     address = virtual_to_physical_address(address, 1);
     if (address == 0x00000000)
         return;
@@ -2615,7 +2612,7 @@ void write_ai()
     {
     case 0x4:
         ai_register.ai_len = word;
-        g_core->plugin_funcs.audio_ai_len_changed();
+        perf_measure(core_perf_ai_len_changed, g_core->plugin_funcs.audio_ai_len_changed);
         g_core->callbacks.ai_len_changed();
         switch (ROM_HEADER.Country_code & 0xFF)
         {
@@ -2697,7 +2694,7 @@ void write_aib()
         temp = ai_register.ai_len;
         *((unsigned char*)&temp + ((*address_low & 3) ^ S8)) = g_byte;
         ai_register.ai_len = temp;
-        g_core->plugin_funcs.audio_ai_len_changed();
+        perf_measure(core_perf_ai_len_changed, g_core->plugin_funcs.audio_ai_len_changed);
         g_core->callbacks.ai_len_changed();
         switch (ROM_HEADER.Country_code & 0xFF)
         {
@@ -2776,7 +2773,7 @@ void write_aih()
         temp = ai_register.ai_len;
         *((uint16_t*)((unsigned char*)&temp + ((*address_low & 3) ^ S16))) = hword;
         ai_register.ai_len = temp;
-        g_core->plugin_funcs.audio_ai_len_changed();
+        perf_measure(core_perf_ai_len_changed, g_core->plugin_funcs.audio_ai_len_changed);
         g_core->callbacks.ai_len_changed();
         switch (ROM_HEADER.Country_code & 0xFF)
         {
@@ -2849,7 +2846,7 @@ void write_aid()
     case 0x0:
         ai_register.ai_dram_addr = dword >> 32;
         ai_register.ai_len = dword & 0xFFFFFFFF;
-        g_core->plugin_funcs.audio_ai_len_changed();
+        perf_measure(core_perf_ai_len_changed, g_core->plugin_funcs.audio_ai_len_changed);
         g_core->callbacks.ai_len_changed();
         switch (ROM_HEADER.Country_code & 0xFF)
         {
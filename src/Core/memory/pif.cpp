@@ -9,9 +9,11 @@
 #include <memory/memory.h>
 #include <memory/pif.h>
 #include <memory/pif_lut.h>
+#include <memory/save_media.h>
 #include <memory/savestates.h>
 #include <cheats.h>
 #include <r4300/r4300.h>
+#include <r4300/tracelog.h>
 #include <r4300/vcr.h>
 
 // Amount of VIs since last input poll
@@ -62,19 +64,15 @@ void EepromCommand(uint8_t* Command)
         break;
     case 4: // read
         {
-            fseek(g_eeprom_file, 0, SEEK_SET);
-            fread(eeprom, 1, 0x800, g_eeprom_file);
+            save_media_read(save_media_eeprom, eeprom, sizeof(eeprom));
             memcpy(&Command[4], eeprom + Command[3] * 8, 8);
         }
         break;
     case 5: // write
         {
-            fseek(g_eeprom_file, 0, SEEK_SET);
-            fread(eeprom, 1, 0x800, g_eeprom_file);
+            save_media_read(save_media_eeprom, eeprom, sizeof(eeprom));
             memcpy(eeprom + Command[3] * 8, &Command[4], 8);
-
-            fseek(g_eeprom_file, 0, SEEK_SET);
-            fwrite(eeprom, 1, 0x800, g_eeprom_file);
+            save_media_write(save_media_eeprom, eeprom, sizeof(eeprom));
         }
         break;
     default:
@@ -466,11 +464,7 @@ void internal_ControllerCommand(int32_t Control, uint8_t* Command)
                         address &= 0xFFE0;
                         if (address <= 0x7FE0)
                         {
-                            fseek(g_mpak_file, 0, SEEK_SET);
-                            fread(mempack[0], 1, 0x8000, g_mpak_file);
-                            fread(mempack[1], 1, 0x8000, g_mpak_file);
-                            fread(mempack[2], 1, 0x8000, g_mpak_file);
-                            fread(mempack[3], 1, 0x8000, g_mpak_file);
+                            save_media_read(save_media_mempak, mempack, sizeof(mempack));
 
                             memcpy(&Command[5], &mempack[Control][address], 0x20);
                         }
@@ -509,19 +503,11 @@ void internal_ControllerCommand(int32_t Control, uint8_t* Command)
                         address &= 0xFFE0;
                         if (address <= 0x7FE0)
                         {
-                            fseek(g_mpak_file, 0, SEEK_SET);
-                            fread(mempack[0], 1, 0x8000, g_mpak_file);
-                            fread(mempack[1], 1, 0x8000, g_mpak_file);
-                            fread(mempack[2], 1, 0x8000, g_mpak_file);
-                            fread(mempack[3], 1, 0x8000, g_mpak_file);
+                            save_media_read(save_media_mempak, mempack, sizeof(mempack));
 
                             memcpy(&mempack[Control][address], &Command[5], 0x20);
 
-                            fseek(g_mpak_file, 0, SEEK_SET);
-                            fwrite(mempack[0], 1, 0x8000, g_mpak_file);
-                            fwrite(mempack[1], 1, 0x8000, g_mpak_file);
-                            fwrite(mempack[2], 1, 0x8000, g_mpak_file);
-                            fwrite(mempack[3], 1, 0x8000, g_mpak_file);
+                            save_media_write(save_media_mempak, mempack, sizeof(mempack));
                         }
                         Command[0x25] = mempack_crc(&Command[5]);
                     }
@@ -689,6 +675,7 @@ void update_pif_read()
                         while (g_wait_counter)
                         {
                             std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                            tracelog_do_work();
                             if (stAllowed)
                             {
                                 st_do_work();
@@ -700,6 +687,7 @@ void update_pif_read()
                             std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
                             g_core->callbacks.interval();
+                            tracelog_do_work();
 
                             if (stAllowed)
                             {
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "stdafx.h"
+#include "save_media.h"
+#include <Core.h>
+#include <IOHelpers.h>
+
+#ifdef WIN32
+#include <Windows.h>
+#endif
+
+// Save media are served from memory while the ROM runs, the files are only touched when loading and when writing back.
+// Write-backs go to a temporary file which then replaces the real one, so a crash mid-write never leaves a torn save behind.
+// Alternatively, media can be mapped into memory. Reads and writes then go straight to the view and flushing merely asks the OS to write the dirty pages.
+
+typedef struct {
+    std::filesystem::path path;
+    // The file's contents, including any pending changes. Unused if the medium is mapped.
+    std::vector<uint8_t> data;
+#ifdef WIN32
+    bool mapped;
+    HANDLE file;
+    HANDLE mapping;
+    // The mapped view of the file. Null while the file is empty, since empty files can't be mapped.
+    uint8_t* view;
+    size_t view_size;
+#endif
+    // The byte range modified since the last write-back, empty if the medium is clean.
+    size_t dirty_start;
+    size_t dirty_end;
+} t_save_medium;
+
+static t_save_medium g_media[save_media_count]{};
+
+static std::chrono::steady_clock::time_point g_last_writeback{};
+
+// Write-backs are numbered so a late background write can't overwrite newer contents written by a later one.
+static std::atomic<uint64_t> g_writeback_generation{};
+
+// Serializes write-backs per medium.
+static std::mutex g_writeback_mutex[save_media_count];
+
+static uint64_t g_written_generation[save_media_count]{};
+
+// Whether the last write-back of a medium failed, in which case the medium is considered dirty until a write-back succeeds.
+static std::atomic<bool> g_writeback_failed[save_media_count]{};
+
+// The amount of background write-backs which haven't completed yet.
+static size_t g_pending_writebacks{};
+static std::mutex g_pending_writebacks_mutex;
+static std::condition_variable g_pending_writebacks_cv;
+
+static bool is_dirty(const t_save_medium& medium)
+{
+    return medium.dirty_start < medium.dirty_end;
+}
+
+static std::span<uint8_t> get_contents(t_save_medium& medium)
+{
+#ifdef WIN32
+    if (medium.mapped)
+    {
+        return {medium.view, medium.view_size};
+    }
+#endif
+    return medium.data;
+}
+
+#ifdef WIN32
+static void unmap(t_save_medium& medium)
+{
+    if (medium.view)
+    {
+        UnmapViewOfFile(medium.view);
+        medium.view = nullptr;
+    }
+    if (medium.mapping)
+    {
+        CloseHandle(medium.mapping);
+        medium.mapping = nullptr;
+    }
+    medium.view_size = 0;
+}
+
+/**
+ * Maps the medium's file with the specified size, extending the file if it's smaller.
+ */
+static bool map(t_save_medium& medium, const size_t size)
+{
+    unmap(medium);
+
+    if (size == 0)
+    {
+        return true;
+    }
+
+    medium.mapping = CreateFileMappingW(medium.file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, nullptr);
+    if (!medium.mapping)
+    {
+        return false;
+    }
+
+    medium.view = (uint8_t*)MapViewOfFile(medium.mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!medium.view)
+    {
+        unmap(medium);
+        return false;
+    }
+
+    medium.view_size = size;
+    return true;
+}
+
+static void close_mapped(t_save_medium& medium)
+{
+    if (medium.view)
+    {
+        FlushViewOfFile(medium.view, 0);
+    }
+    unmap(medium);
+
+    if (medium.file)
+    {
+        FlushFileBuffers(medium.file);
+        CloseHandle(medium.file);
+        medium.file = nullptr;
+    }
+}
+
+static bool open_mapped(t_save_medium& medium)
+{
+    medium.mapped = true;
+    medium.file = CreateFileW(medium.path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (medium.file == INVALID_HANDLE_VALUE)
+    {
+        medium.file = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(medium.file, &size) || !map(medium, (size_t)size.QuadPart))
+    {
+        close_mapped(medium);
+        return false;
+    }
+
+    return true;
+}
+#endif
+
+static bool grow(t_save_medium& medium, const size_t size)
+{
+#ifdef WIN32
+    if (medium.mapped)
+    {
+        const auto old_size = medium.view_size;
+        if (!map(medium, size))
+        {
+            g_core->log_error(std::format(L"[SaveMedia] Failed to extend mapping of {} to {} bytes", medium.path.wstring(), size));
+            map(medium, old_size);
+            return false;
+        }
+
+        // Not every filesystem guarantees the extended part of the file is zeroed
+        memset(medium.view + old_size, 0, size - old_size);
+        return true;
+    }
+#endif
+    medium.data.resize(size);
+    return true;
+}
+
+/**
+ * Writes a medium's contents to its file, marking the medium as failed if that doesn't work out.
+ * \return Whether the file holds the contents or newer ones afterwards.
+ */
+static bool write_back(const size_t index, const std::filesystem::path& path, const std::vector<uint8_t>& data, const uint64_t generation)
+{
+    std::scoped_lock lock(g_writeback_mutex[index]);
+
+    if (g_written_generation[index] > generation)
+    {
+        return true;
+    }
+
+    auto tmp_path = path;
+    tmp_path += L".tmp";
+
+    FILE* f = nullptr;
+    if (fopen_s(&f, tmp_path.string().c_str(), "wb"))
+    {
+        g_core->log_error(std::format(L"[SaveMedia] Failed to open {} for writing", tmp_path.wstring()));
+        g_writeback_failed[index] = true;
+        return false;
+    }
+
+    const bool written = fwrite(data.data(), 1, data.size(), f) == data.size();
+    const bool closed = fclose(f) == 0;
+
+    std::error_code ec;
+    if (!written || !closed)
+    {
+        g_core->log_error(std::format(L"[SaveMedia] Failed to write {}", tmp_path.wstring()));
+        std::filesystem::remove(tmp_path, ec);
+        g_writeback_failed[index] = true;
+        return false;
+    }
+
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        g_core->log_error(std::format(L"[SaveMedia] Failed to replace {}: {}", path.wstring(), string_to_wstring(ec.message())));
+        std::filesystem::remove(tmp_path, ec);
+        g_writeback_failed[index] = true;
+        return false;
+    }
+
+    g_written_generation[index] = generation;
+    return true;
+}
+
+bool save_media_open(const save_media medium, const std::filesystem::path& path)
+{
+    g_core->log_info(std::format(L"[SaveMedia] Loading {}...", path.wstring()));
+
+    auto& m = g_media[medium];
+    m = {};
+    m.path = path;
+    m.dirty_start = SIZE_MAX;
+    m.dirty_end = 0;
+
+#ifdef WIN32
+    if (g_core->cfg->save_media_backend == save_media_backend_mapped)
+    {
+        return open_mapped(m);
+    }
+#endif
+
+    if (!exists(path))
+    {
+        FILE* f = nullptr;
+        if (fopen_s(&f, path.string().c_str(), "w"))
+        {
+            return false;
+        }
+        fclose(f);
+        return true;
+    }
+
+    return read_file_buffer(path, m.data);
+}
+
+void save_media_close()
+{
+    // Background write-backs must land before the files can be touched by anyone else, e.g. when clearing save data on reset.
+    // They're awaited before the final flush so that one which failed is retried by it.
+    {
+        std::unique_lock lock(g_pending_writebacks_mutex);
+        g_pending_writebacks_cv.wait(lock, [] { return g_pending_writebacks == 0; });
+    }
+
+    save_media_flush(false);
+
+    for (size_t i = 0; i < save_media_count; ++i)
+    {
+        auto& medium = g_media[i];
+
+        if (g_writeback_failed[i].exchange(false))
+        {
+            g_core->show_dialog(std::format(L"Failed to write save data to {}.\nThe changes since the last successful write are lost.", medium.path.wstring()).c_str(), L"Core", fsvc_error);
+        }
+
+#ifdef WIN32
+        close_mapped(medium);
+#endif
+        medium = {};
+    }
+}
+
+void save_media_read(const save_media medium, void* dst, const size_t size)
+{
+    const auto contents = get_contents(g_media[medium]);
+    memcpy(dst, contents.data(), std::min(size, contents.size()));
+}
+
+void save_media_write(const save_media medium, const void* src, const size_t size)
+{
+    auto& m = g_media[medium];
+
+    // Growing the medium must reach the file even if the new bytes happen to be zero
+    if (const auto old_size = get_contents(m).size(); old_size < size)
+    {
+        if (!grow(m, size))
+        {
+            return;
+        }
+        m.dirty_start = std::min(m.dirty_start, old_size);
+        m.dirty_end = size;
+    }
+
+    const auto contents = get_contents(m);
+
+    // Games usually rewrite the whole image with only a few bytes changed, so only the actual differences count as dirty
+    const auto bytes = (const uint8_t*)src;
+    const auto first = std::mismatch(bytes, bytes + size, contents.data()).first - bytes;
+    if (first == (ptrdiff_t)size)
+    {
+        return;
+    }
+
+    size_t last = size;
+    while (last > (size_t)first && bytes[last - 1] == contents[last - 1])
+    {
+        --last;
+    }
+
+    memcpy(contents.data() + first, bytes + first, last - first);
+    m.dirty_start = std::min(m.dirty_start, (size_t)first);
+    m.dirty_end = std::max(m.dirty_end, last);
+}
+
+void save_media_flush(const bool async)
+{
+    for (size_t i = 0; i < save_media_count; ++i)
+    {
+        auto& m = g_media[i];
+
+        // A failed write-back leaves the file behind the contents, so the whole medium is written again
+        if (!m.path.empty() && g_writeback_failed[i].exchange(false))
+        {
+            m.dirty_start = 0;
+            m.dirty_end = std::max(m.dirty_end, get_contents(m).size());
+        }
+
+        if (m.path.empty() || !is_dirty(m))
+        {
+            continue;
+        }
+
+        g_core->log_trace(std::format(L"[SaveMedia] Writing back {} (dirty {:#x}-{:#x})...", m.path.wstring(), m.dirty_start, m.dirty_end));
+
+#ifdef WIN32
+        if (m.mapped)
+        {
+            if (!FlushViewOfFile(m.view + m.dirty_start, m.dirty_end - m.dirty_start))
+            {
+                g_core->log_error(std::format(L"[SaveMedia] Failed to flush mapping of {}", m.path.wstring()));
+                g_writeback_failed[i] = true;
+            }
+            m.dirty_start = SIZE_MAX;
+            m.dirty_end = 0;
+            continue;
+        }
+#endif
+
+        const auto generation = ++g_writeback_generation;
+        m.dirty_start = SIZE_MAX;
+        m.dirty_end = 0;
+
+        if (async)
+        {
+            {
+                std::scoped_lock lock(g_pending_writebacks_mutex);
+                ++g_pending_writebacks;
+            }
+
+            g_core->submit_task([i, path = m.path, data = m.data, generation] {
+                write_back(i, path, data, generation);
+
+                std::scoped_lock lock(g_pending_writebacks_mutex);
+                --g_pending_writebacks;
+                g_pending_writebacks_cv.notify_all();
+            });
+        }
+        else
+        {
+            write_back(i, m.path, m.data, generation);
+        }
+    }
+
+    g_last_writeback = std::chrono::steady_clock::now();
+}
+
+void save_media_tick()
+{
+    bool dirty = false;
+    for (size_t i = 0; i < save_media_count; ++i)
+    {
+        dirty |= is_dirty(g_media[i]) || g_writeback_failed[i];
+    }
+
+    if (!dirty)
+    {
+        return;
+    }
+
+    if (std::chrono::steady_clock::now() - g_last_writeback < SAVE_MEDIA_WRITEBACK_INTERVAL)
+    {
+        return;
+    }
+
+    save_media_flush(true);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+/**
+ * A save medium backed by a file in the saves directory.
+ * \remarks FlashRAM erases and writes have always gone through the SRAM file while DMA reads come from the FlashRAM file, so both media are involved in FlashRAM emulation.
+ */
+typedef enum {
+    save_media_eeprom,
+    save_media_sram,
+    save_media_flashram,
+    save_media_mempak,
+    save_media_count,
+} save_media;
+
+/**
+ * The backend serving a save medium's contents, selected by <c>core_cfg::save_media_backend</c>.
+ */
+typedef enum {
+    // The contents are kept in a buffer and written back to the file in the background.
+    save_media_backend_buffered,
+    // The file is mapped into memory and the contents are accessed through the view. Only available on Windows, other platforms fall back to buffering.
+    save_media_backend_mapped,
+} save_media_backend;
+
+/**
+ * The minimum time between two automatic write-backs of a dirty medium.
+ */
+constexpr auto SAVE_MEDIA_WRITEBACK_INTERVAL = std::chrono::seconds(2);
+
+/**
+ * \brief Loads or maps a medium's file, creating the file if it doesn't exist.
+ * \param medium The medium.
+ * \param path The medium's file.
+ * \return Whether the operation succeeded.
+ */
+bool save_media_open(save_media medium, const std::filesystem::path& path);
+
+/**
+ * \brief Writes back all dirty media synchronously and unloads or unmaps them.
+ */
+void save_media_close();
+
+/**
+ * \brief Copies the start of a medium's contents into a buffer.
+ * \param medium The medium.
+ * \param dst The destination buffer.
+ * \param size The buffer's size. If the medium is smaller, the rest of the buffer is left untouched, just like a short file read.
+ */
+void save_media_read(save_media medium, void* dst, size_t size);
+
+/**
+ * \brief Replaces the start of a medium's contents and marks the changed range as dirty.
+ * \param medium The medium.
+ * \param src The source buffer.
+ * \param size The buffer's size. The medium grows if it's smaller.
+ */
+void save_media_write(save_media medium, const void* src, size_t size);
+
+/**
+ * \brief Writes back all dirty media.
+ * \param async Whether the files should be written on a background task. The contents are snapshotted before returning either way.
+ * \remarks Mapped media are flushed in place regardless of <c>async</c>, since the OS performs the actual write-back.
+ */
+void save_media_flush(bool async);
+
+/**
+ * \brief Writes back dirty media asynchronously if the write-back interval has elapsed. Must be called periodically from the emu thread.
+ */
+void save_media_tick();
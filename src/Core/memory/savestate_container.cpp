@@ -0,0 +1,570 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "stdafx.h"
+#include "savestate_container.h"
+#include <libdeflate.h>
+#include <BS_thread_pool.hpp>
+
+// Layout:
+//  t_st_container_header
+//  t_st_container_entry[section_count]
+//  section data, in table of contents order
+//
+// The writer always emits every section, including empty ones, in a fixed order. This keeps the offsets of the fixed-size sections stable across savestates.
+//
+// Block-encoded section data:
+//  uint32_t block_count
+//  uint32_t block_stored_size[block_count]
+//  raw deflate streams, one per ST_CONTAINER_BLOCK_SIZE bytes of section data (the last one may be shorter)
+
+constexpr char ST_CONTAINER_MAGIC[8] = {'M', '6', '4', 'S', 'T', 'A', 'T', 'E'};
+
+// Upper bound for the section count, used to reject garbage before allocating the table of contents.
+constexpr uint32_t ST_CONTAINER_MAX_SECTIONS = 64;
+
+constexpr int ST_CONTAINER_COMPRESSION_LEVEL = 6;
+
+// The amount of section data compressed independently of the rest. Smaller blocks parallelize better but compress worse.
+constexpr size_t ST_CONTAINER_BLOCK_SIZE = 0x100000;
+
+// The pool which savestate blocks are compressed and decompressed on.
+static BS::thread_pool g_block_pool{};
+
+/**
+ * Gets the calling thread's compressor. Compressors are large, so we keep one per thread instead of allocating one per block.
+ */
+static libdeflate_compressor* get_compressor()
+{
+    thread_local std::unique_ptr<libdeflate_compressor, decltype(&libdeflate_free_compressor)> compressor(libdeflate_alloc_compressor(ST_CONTAINER_COMPRESSION_LEVEL), &libdeflate_free_compressor);
+    return compressor.get();
+}
+
+/**
+ * Gets the calling thread's decompressor.
+ */
+static libdeflate_decompressor* get_decompressor()
+{
+    thread_local std::unique_ptr<libdeflate_decompressor, decltype(&libdeflate_free_decompressor)> decompressor(libdeflate_alloc_decompressor(), &libdeflate_free_decompressor);
+    return decompressor.get();
+}
+
+constexpr uint32_t fourcc(const char (&str)[5])
+{
+    return static_cast<uint32_t>(str[0]) | static_cast<uint32_t>(str[1]) << 8 | static_cast<uint32_t>(str[2]) << 16 | static_cast<uint32_t>(str[3]) << 24;
+}
+
+constexpr uint32_t SECTION_TAGS[core_st_section_count] = {
+fourcc("REGS"),
+fourcc("RDRM"),
+fourcc("SPMM"),
+fourcc("TLBL"),
+fourcc("EVTQ"),
+fourcc("VCRF"),
+fourcc("SCRN"),
+};
+
+static size_t entry_offset(const size_t index)
+{
+    return sizeof(t_st_container_header) + index * sizeof(t_st_container_entry);
+}
+
+static t_st_container_entry read_entry(std::span<const uint8_t> buf, const size_t index)
+{
+    t_st_container_entry entry;
+    memcpy(&entry, buf.data() + entry_offset(index), sizeof(entry));
+    return entry;
+}
+
+static void write_entry(std::span<uint8_t> buf, const size_t index, const t_st_container_entry& entry)
+{
+    memcpy(buf.data() + entry_offset(index), &entry, sizeof(entry));
+}
+
+static uint32_t crc32(std::span<const uint8_t> data)
+{
+    return libdeflate_crc32(0, data.data(), data.size());
+}
+
+/**
+ * Reads and validates the table of contents.
+ */
+static bool read_toc(std::span<const uint8_t> buf, t_st_container_header& header, std::vector<t_st_container_entry>& entries)
+{
+    if (!st_container_read_header(buf, header))
+    {
+        return false;
+    }
+
+    if (buf.size() < entry_offset(header.section_count))
+    {
+        return false;
+    }
+
+    entries.resize(header.section_count);
+    for (size_t i = 0; i < header.section_count; ++i)
+    {
+        entries[i] = read_entry(buf, i);
+    }
+    return true;
+}
+
+static const t_st_container_entry* find_entry(const std::vector<t_st_container_entry>& entries, const core_st_section section)
+{
+    for (const auto& entry : entries)
+    {
+        if (entry.tag == SECTION_TAGS[section])
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+static size_t block_count(const size_t size)
+{
+    return (size + ST_CONTAINER_BLOCK_SIZE - 1) / ST_CONTAINER_BLOCK_SIZE;
+}
+
+/**
+ * Decodes block-encoded section data into the destination in parallel.
+ */
+static core_result decode_blocks(const t_st_container_entry& entry, std::span<const uint8_t> stored, uint8_t* dest)
+{
+    uint32_t count;
+    if (stored.size() < sizeof(count))
+    {
+        return ST_DecompressionError;
+    }
+    memcpy(&count, stored.data(), sizeof(count));
+
+    if (count != block_count(entry.size) || (stored.size() - sizeof(count)) / sizeof(uint32_t) < count)
+    {
+        return ST_DecompressionError;
+    }
+
+    // Resolve the block boundaries up front so the blocks can be decoded independently.
+    std::vector<std::span<const uint8_t>> blocks(count);
+    size_t offset = sizeof(count) + count * sizeof(uint32_t);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t block_size;
+        memcpy(&block_size, stored.data() + sizeof(count) + i * sizeof(uint32_t), sizeof(block_size));
+
+        if (block_size > stored.size() - offset)
+        {
+            return ST_DecompressionError;
+        }
+
+        blocks[i] = stored.subspan(offset, block_size);
+        offset += block_size;
+    }
+
+    std::atomic<bool> failed = false;
+    g_block_pool.submit_sequence(size_t{0}, blocks.size(), [&](const size_t i) {
+        const size_t block_offset = i * ST_CONTAINER_BLOCK_SIZE;
+        const size_t block_size = std::min(ST_CONTAINER_BLOCK_SIZE, static_cast<size_t>(entry.size) - block_offset);
+
+        const auto result = libdeflate_deflate_decompress(get_decompressor(), blocks[i].data(), blocks[i].size(), dest + block_offset, block_size, nullptr);
+
+        if (result != LIBDEFLATE_SUCCESS)
+        {
+            failed = true;
+        }
+    })
+    .wait();
+
+    return failed ? ST_DecompressionError : Res_Ok;
+}
+
+/**
+ * Decodes a section's stored data into the destination, which must be <c>entry.size</c> bytes large.
+ */
+static core_result decode_section(const t_st_container_entry& entry, std::span<const uint8_t> stored, uint8_t* dest)
+{
+    switch (entry.encoding)
+    {
+    case st_section_encoding_raw:
+        if (stored.size() != entry.size)
+        {
+            return ST_DecompressionError;
+        }
+        memcpy(dest, stored.data(), stored.size());
+        break;
+    case st_section_encoding_deflate:
+        {
+            const auto result = libdeflate_deflate_decompress(get_decompressor(), stored.data(), stored.size(), dest, entry.size, nullptr);
+            if (result != LIBDEFLATE_SUCCESS)
+            {
+                return ST_DecompressionError;
+            }
+            break;
+        }
+    case st_section_encoding_deflate_blocks:
+        {
+            const auto result = decode_blocks(entry, stored, dest);
+            if (result != Res_Ok)
+            {
+                return result;
+            }
+            break;
+        }
+    default:
+        return ST_DecompressionError;
+    }
+
+    if (crc32({dest, entry.size}) != entry.crc32)
+    {
+        return ST_ChecksumMismatch;
+    }
+
+    return Res_Ok;
+}
+
+bool st_container_is_sectioned(std::span<const uint8_t> buf)
+{
+    return buf.size() >= sizeof(ST_CONTAINER_MAGIC) && !memcmp(buf.data(), ST_CONTAINER_MAGIC, sizeof(ST_CONTAINER_MAGIC));
+}
+
+void st_container_begin(std::vector<uint8_t>& buf, const char* rom_md5)
+{
+    t_st_container_header header{};
+    memcpy(header.magic, ST_CONTAINER_MAGIC, sizeof(header.magic));
+    header.version = ST_CONTAINER_VERSION;
+    header.section_count = core_st_section_count;
+    memcpy(header.rom_md5, rom_md5, sizeof(header.rom_md5));
+
+    buf.clear();
+    buf.resize(entry_offset(core_st_section_count));
+    memcpy(buf.data(), &header, sizeof(header));
+
+    for (size_t i = 0; i < core_st_section_count; ++i)
+    {
+        write_entry(buf, i, t_st_container_entry{.tag = SECTION_TAGS[i], .encoding = st_section_encoding_raw});
+    }
+}
+
+void st_container_begin_section(std::vector<uint8_t>& buf, const core_st_section section)
+{
+    auto entry = read_entry(buf, section);
+    entry.offset = buf.size();
+    write_entry(buf, section, entry);
+}
+
+void st_container_end_section(std::vector<uint8_t>& buf, const core_st_section section)
+{
+    auto entry = read_entry(buf, section);
+    entry.size = entry.stored_size = buf.size() - entry.offset;
+    entry.crc32 = crc32({buf.data() + entry.offset, entry.size});
+    write_entry(buf, section, entry);
+}
+
+void st_container_refresh_section(std::span<uint8_t> buf, const core_st_section section)
+{
+    auto entry = read_entry(buf, section);
+    entry.crc32 = crc32({buf.data() + entry.offset, entry.size});
+    write_entry(buf, section, entry);
+}
+
+void st_container_set_section_crc32(std::span<uint8_t> buf, const core_st_section section, const uint32_t crc32)
+{
+    auto entry = read_entry(buf, section);
+    entry.crc32 = crc32;
+    write_entry(buf, section, entry);
+}
+
+uint32_t st_container_crc32(std::span<const uint8_t> data)
+{
+    return crc32(data);
+}
+
+/**
+ * Multiplies two polynomials modulo the CRC32 polynomial, with bits in reflected order.
+ */
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    while (true)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+            {
+                break;
+            }
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ 0xEDB88320 : b >> 1;
+    }
+    return p;
+}
+
+uint32_t st_container_concat_crc32(std::span<const uint32_t> crcs, const size_t block_size)
+{
+    // x^(8 * block_size) mod P, which appends a block's worth of bits to a checksum (see zlib's crc32_combine)
+    uint32_t shift = 1u << 31;
+    uint32_t x = 1u << 30;
+    for (size_t n = block_size * 8; n; n >>= 1)
+    {
+        if (n & 1)
+        {
+            shift = crc32_multmodp(x, shift);
+        }
+        x = crc32_multmodp(x, x);
+    }
+
+    uint32_t crc = 0;
+    for (const auto block_crc : crcs)
+    {
+        crc = crc32_multmodp(shift, crc) ^ block_crc;
+    }
+    return crc;
+}
+
+bool st_container_locate_section(std::span<const uint8_t> buf, const core_st_section section, size_t& offset, size_t& size)
+{
+    t_st_container_header header;
+    std::vector<t_st_container_entry> entries;
+    if (!read_toc(buf, header, entries) || header.version != ST_CONTAINER_VERSION)
+    {
+        return false;
+    }
+
+    const auto entry = find_entry(entries, section);
+    if (!entry || entry->encoding != st_section_encoding_raw || entry->stored_size != entry->size || entry->offset > buf.size() || entry->size > buf.size() - entry->offset)
+    {
+        return false;
+    }
+
+    offset = entry->offset;
+    size = entry->size;
+    return true;
+}
+
+bool st_container_read_header(std::span<const uint8_t> buf, t_st_container_header& header)
+{
+    if (buf.size() < sizeof(header) || !st_container_is_sectioned(buf))
+    {
+        return false;
+    }
+
+    memcpy(&header, buf.data(), sizeof(header));
+
+    return header.version != 0 && header.version <= ST_CONTAINER_VERSION && header.section_count <= ST_CONTAINER_MAX_SECTIONS;
+}
+
+core_result st_container_get_section(std::span<const uint8_t> buf, const core_st_section section, std::span<const uint8_t>& data)
+{
+    t_st_container_header header;
+    std::vector<t_st_container_entry> entries;
+    if (!read_toc(buf, header, entries))
+    {
+        return ST_DecompressionError;
+    }
+
+    const auto entry = find_entry(entries, section);
+    if (!entry || entry->size == 0)
+    {
+        return ST_SectionNotFound;
+    }
+
+    if (entry->encoding != st_section_encoding_raw || entry->stored_size != entry->size || entry->offset > buf.size() || entry->size > buf.size() - entry->offset)
+    {
+        return ST_DecompressionError;
+    }
+
+    data = buf.subspan(entry->offset, entry->size);
+
+    if (crc32(data) != entry->crc32)
+    {
+        return ST_ChecksumMismatch;
+    }
+
+    return Res_Ok;
+}
+
+void st_container_compress(std::span<const uint8_t> buf, std::vector<uint8_t>& out)
+{
+    t_st_container_header header;
+    std::vector<t_st_container_entry> entries;
+    if (!read_toc(buf, header, entries))
+    {
+        assert(false);
+        out.clear();
+        return;
+    }
+
+    // A unit of work for the compression pool.
+    struct t_block {
+        size_t entry_index;
+        std::span<const uint8_t> data;
+        // Where the block is compressed to. Slots are laid out at the block's worst-case final position, so compaction only ever moves data backwards.
+        size_t slot;
+        size_t compressed_size;
+    };
+
+    std::vector<t_block> blocks;
+    size_t slot = entry_offset(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const auto& entry = entries[i];
+        assert(entry.encoding == st_section_encoding_raw);
+
+        if (entry.size == 0)
+        {
+            continue;
+        }
+
+        slot += sizeof(uint32_t) * (1 + block_count(entry.size));
+        for (size_t offset = 0; offset < entry.size; offset += ST_CONTAINER_BLOCK_SIZE)
+        {
+            const auto data = buf.subspan(entry.offset + offset, std::min(ST_CONTAINER_BLOCK_SIZE, static_cast<size_t>(entry.size) - offset));
+            blocks.push_back(t_block{
+            .entry_index = i,
+            .data = data,
+            .slot = slot,
+            });
+            slot += libdeflate_deflate_compress_bound(get_compressor(), data.size());
+        }
+    }
+
+    out.resize(slot);
+    memcpy(out.data(), buf.data(), entry_offset(entries.size()));
+
+    g_block_pool.submit_sequence(size_t{0}, blocks.size(), [&](const size_t i) {
+        auto& block = blocks[i];
+        const size_t bound = libdeflate_deflate_compress_bound(get_compressor(), block.data.size());
+        block.compressed_size = libdeflate_deflate_compress(get_compressor(), block.data.data(), block.data.size(), out.data() + block.slot, bound);
+    })
+    .wait();
+
+    // Compact the compressed sections in table of contents order. The output doesn't depend on how the work was scheduled.
+    size_t offset = entry_offset(entries.size());
+    auto block = blocks.begin();
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        auto entry = entries[i];
+        entry.offset = offset;
+
+        if (entry.size != 0)
+        {
+            const auto count = static_cast<uint32_t>(block_count(entry.size));
+            const auto first_block = block;
+
+            memcpy(out.data() + offset, &count, sizeof(count));
+            offset += sizeof(count);
+            for (; block != blocks.end() && block->entry_index == i; ++block)
+            {
+                const auto block_size = static_cast<uint32_t>(block->compressed_size);
+                memcpy(out.data() + offset, &block_size, sizeof(block_size));
+                offset += sizeof(block_size);
+            }
+            for (auto it = first_block; it != block; ++it)
+            {
+                memmove(out.data() + offset, out.data() + it->slot, it->compressed_size);
+                offset += it->compressed_size;
+            }
+
+            entry.encoding = st_section_encoding_deflate_blocks;
+        }
+
+        entry.stored_size = offset - entry.offset;
+        write_entry(out, i, entry);
+    }
+
+    out.resize(offset);
+}
+
+core_result st_container_decompress(std::span<const uint8_t> buf, std::vector<uint8_t>& out)
+{
+    t_st_container_header header;
+    std::vector<t_st_container_entry> entries;
+    if (!read_toc(buf, header, entries))
+    {
+        return ST_DecompressionError;
+    }
+
+    size_t total_size = entry_offset(entries.size());
+    for (const auto& entry : entries)
+    {
+        if (entry.offset > buf.size() || entry.stored_size > buf.size() - entry.offset)
+        {
+            return ST_DecompressionError;
+        }
+        total_size += entry.size;
+    }
+
+    out.resize(total_size);
+    memcpy(out.data(), buf.data(), entry_offset(entries.size()));
+
+    size_t offset = entry_offset(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        auto entry = entries[i];
+
+        const auto result = decode_section(entry, buf.subspan(entry.offset, entry.stored_size), out.data() + offset);
+        if (result != Res_Ok)
+        {
+            return result;
+        }
+
+        entry.encoding = st_section_encoding_raw;
+        entry.offset = offset;
+        entry.stored_size = entry.size;
+        write_entry(out, i, entry);
+
+        offset += entry.size;
+    }
+
+    return Res_Ok;
+}
+
+core_result st_container_read_file_section(const std::filesystem::path& path, const core_st_section section, std::vector<uint8_t>& data)
+{
+    FILE* f = nullptr;
+    if (fopen_s(&f, path.string().c_str(), "rb"))
+    {
+        return ST_NotFound;
+    }
+
+    std::vector<uint8_t> toc(sizeof(t_st_container_header));
+    t_st_container_header header;
+    std::vector<t_st_container_entry> entries;
+
+    if (fread(toc.data(), 1, toc.size(), f) != toc.size() || !st_container_read_header(toc, header))
+    {
+        fclose(f);
+        return ST_SectionNotFound;
+    }
+
+    toc.resize(entry_offset(header.section_count));
+    const size_t toc_remaining = toc.size() - sizeof(t_st_container_header);
+    if (fread(toc.data() + sizeof(t_st_container_header), 1, toc_remaining, f) != toc_remaining || !read_toc(toc, header, entries))
+    {
+        fclose(f);
+        return ST_DecompressionError;
+    }
+
+    const auto entry = find_entry(entries, section);
+    if (!entry || entry->size == 0)
+    {
+        fclose(f);
+        return ST_SectionNotFound;
+    }
+
+    std::vector<uint8_t> stored(entry->stored_size);
+    if (fseek(f, static_cast<long>(entry->offset), SEEK_SET) || fread(stored.data(), 1, stored.size(), f) != stored.size())
+    {
+        fclose(f);
+        return ST_DecompressionError;
+    }
+    fclose(f);
+
+    data.resize(entry->size);
+    return decode_section(*entry, stored, data.data());
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <include/core_api.h>
+
+/**
+ * The current version of the sectioned savestate format.
+ */
+constexpr uint32_t ST_CONTAINER_VERSION = 2;
+
+enum {
+    // The section's data is stored as-is.
+    st_section_encoding_raw,
+    // The section's data is stored as a raw deflate stream.
+    st_section_encoding_deflate,
+    // The section's data is split into fixed-size blocks which are stored as independent raw deflate streams, allowing parallel compression and decompression.
+    st_section_encoding_deflate_blocks,
+};
+
+#pragma pack(push, 1)
+/**
+ * The header of a sectioned savestate. Followed by <c>section_count</c> entries which form the table of contents.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    char rom_md5[32];
+} t_st_container_header;
+
+/**
+ * An entry in the table of contents of a sectioned savestate.
+ */
+typedef struct {
+    // The section's FourCC tag.
+    uint32_t tag;
+    // How the section's data is stored.
+    uint32_t encoding;
+    // The offset of the section's stored data, relative to the start of the savestate.
+    uint64_t offset;
+    // The size of the section's stored data.
+    uint64_t stored_size;
+    // The size of the section's data after decoding.
+    uint64_t size;
+    // The CRC32 of the section's decoded data.
+    uint32_t crc32;
+    uint32_t reserved;
+} t_st_container_entry;
+#pragma pack(pop)
+
+/**
+ * \brief Gets whether a buffer starts with a sectioned savestate header.
+ * \remarks Legacy savestates start with the ROM's MD5 hash or a gzip header, neither of which can be mistaken for the sectioned header.
+ */
+bool st_container_is_sectioned(std::span<const uint8_t> buf);
+
+/**
+ * \brief Writes the header and an empty table of contents containing every section to a buffer, discarding its contents.
+ * \param buf The target buffer.
+ * \param rom_md5 The ROM's MD5 hash as 32 hex characters.
+ */
+void st_container_begin(std::vector<uint8_t>& buf, const char* rom_md5);
+
+/**
+ * \brief Marks the start of a section's data at the current end of the buffer.
+ */
+void st_container_begin_section(std::vector<uint8_t>& buf, core_st_section section);
+
+/**
+ * \brief Marks the end of a section's data at the current end of the buffer and computes its checksum.
+ */
+void st_container_end_section(std::vector<uint8_t>& buf, core_st_section section);
+
+/**
+ * \brief Recomputes the checksum of a section whose data has been modified in place.
+ * \param buf A buffer written by <c>st_container_begin</c>.
+ * \param section The section.
+ */
+void st_container_refresh_section(std::span<uint8_t> buf, core_st_section section);
+
+/**
+ * \brief Sets the checksum of a section whose data has been modified in place, for callers which computed it themselves.
+ * \param buf A buffer written by <c>st_container_begin</c>.
+ * \param section The section.
+ * \param crc32 The checksum of the section's data.
+ */
+void st_container_set_section_crc32(std::span<uint8_t> buf, core_st_section section, uint32_t crc32);
+
+/**
+ * \brief Computes the checksum used for section data.
+ */
+uint32_t st_container_crc32(std::span<const uint8_t> data);
+
+/**
+ * \brief Computes the checksum of consecutive equally sized blocks from the checksums of the individual blocks.
+ * \param crcs The checksums of the blocks, in order.
+ * \param block_size The size of each block.
+ */
+uint32_t st_container_concat_crc32(std::span<const uint32_t> crcs, size_t block_size);
+
+/**
+ * \brief Gets the location of a section's data in an uncompressed sectioned savestate of the current version, without verifying its checksum.
+ * \param buf The savestate buffer.
+ * \param section The section.
+ * \param offset The offset of the section's data.
+ * \param size The size of the section's data.
+ * \return Whether the section is stored uncompressed and lies within the buffer.
+ */
+bool st_container_locate_section(std::span<const uint8_t> buf, core_st_section section, size_t& offset, size_t& size);
+
+/**
+ * \brief Reads the header of a sectioned savestate.
+ * \return Whether the header is valid.
+ */
+bool st_container_read_header(std::span<const uint8_t> buf, t_st_container_header& header);
+
+/**
+ * \brief Gets a view of a section's data in an uncompressed sectioned savestate and verifies its checksum.
+ * \param buf The savestate buffer.
+ * \param section The section.
+ * \param data The section's data. Only valid as long as the buffer is.
+ * \return The operation result. Empty sections are reported as <c>ST_SectionNotFound</c>.
+ */
+core_result st_container_get_section(std::span<const uint8_t> buf, core_st_section section, std::span<const uint8_t>& data);
+
+/**
+ * \brief Converts an uncompressed sectioned savestate into its on-disk form, in which every section is compressed individually.
+ * Sections are split into blocks which are compressed in parallel. The output is independent of the amount of worker threads.
+ * \param buf The uncompressed savestate.
+ * \param out The compressed savestate. Its capacity is reused.
+ */
+void st_container_compress(std::span<const uint8_t> buf, std::vector<uint8_t>& out);
+
+/**
+ * \brief Converts a sectioned savestate in its on-disk form back into its uncompressed form, verifying every section's checksum.
+ * \param buf The savestate buffer.
+ * \param out The uncompressed savestate.
+ * \return The operation result.
+ */
+core_result st_container_decompress(std::span<const uint8_t> buf, std::vector<uint8_t>& out);
+
+/**
+ * \brief Reads a single section from a sectioned savestate file without reading or decoding the other sections.
+ * \param path The savestate's path.
+ * \param section The section.
+ * \param data The section's decoded data.
+ * \return The operation result.
+ */
+core_result st_container_read_file_section(const std::filesystem::path& path, core_st_section section, std::vector<uint8_t>& data);
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Delta layout:
+//  varint target_size
+//  for each differing page, in ascending order:
+//      varint page_gap (distance from the page following the previous record)
+//      (varint zero_run, varint literal_len, literal_len XOR bytes) until the page is covered
+
+#include "stdafx.h"
+#include "savestate_delta.h"
+
+// Minimum length of a zero run which terminates a literal run. Shorter runs are cheaper to store as literals.
+constexpr size_t MIN_ZERO_RUN = 4;
+
+static void write_varint(std::vector<uint8_t>& out, size_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool read_varint(const uint8_t*& ptr, const uint8_t* end, size_t& value)
+{
+    value = 0;
+    for (size_t shift = 0; shift < sizeof(size_t) * 8; shift += 7)
+    {
+        if (ptr >= end)
+        {
+            return false;
+        }
+        const uint8_t b = *ptr++;
+        value |= static_cast<size_t>(b & 0x7F) << shift;
+        if (!(b & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void st_delta_encode(std::span<const uint8_t> base, std::span<const uint8_t> target, std::vector<uint8_t>& out)
+{
+    out.clear();
+    write_varint(out, target.size());
+
+    uint8_t xored[ST_DELTA_PAGE_SIZE];
+    size_t next_page = 0;
+    const size_t page_count = (target.size() + ST_DELTA_PAGE_SIZE - 1) / ST_DELTA_PAGE_SIZE;
+
+    for (size_t page = 0; page < page_count; ++page)
+    {
+        const size_t offset = page * ST_DELTA_PAGE_SIZE;
+        const size_t len = std::min(ST_DELTA_PAGE_SIZE, target.size() - offset);
+        const size_t base_len = offset < base.size() ? std::min(len, base.size() - offset) : 0;
+
+        if (base_len == len && !memcmp(base.data() + offset, target.data() + offset, len))
+        {
+            continue;
+        }
+
+        bool any_nonzero = false;
+        for (size_t i = 0; i < len; ++i)
+        {
+            xored[i] = target[offset + i] ^ (i < base_len ? base[offset + i] : 0);
+            any_nonzero |= xored[i] != 0;
+        }
+
+        // Bytes past the end of the base are implicitly zero, so an all-zero tail page needs no record.
+        if (!any_nonzero)
+        {
+            continue;
+        }
+
+        write_varint(out, page - next_page);
+        next_page = page + 1;
+
+        size_t i = 0;
+        while (i < len)
+        {
+            const size_t zero_start = i;
+            while (i < len && xored[i] == 0)
+            {
+                ++i;
+            }
+
+            const size_t literal_start = i;
+            while (i < len)
+            {
+                size_t zeros = 0;
+                while (i + zeros < len && zeros < MIN_ZERO_RUN && xored[i + zeros] == 0)
+                {
+                    ++zeros;
+                }
+                if (zeros == MIN_ZERO_RUN || i + zeros == len)
+                {
+                    break;
+                }
+                i += zeros + 1;
+            }
+
+            write_varint(out, literal_start - zero_start);
+            write_varint(out, i - literal_start);
+            out.insert(out.end(), xored + literal_start, xored + i);
+        }
+    }
+}
+
+bool st_delta_decode(std::span<const uint8_t> base, std::span<const uint8_t> delta, std::vector<uint8_t>& out)
+{
+    const uint8_t* ptr = delta.data();
+    const uint8_t* end = delta.data() + delta.size();
+
+    size_t size;
+    if (!read_varint(ptr, end, size))
+    {
+        return false;
+    }
+
+    out.resize(size);
+    const size_t common = std::min(size, base.size());
+    memcpy(out.data(), base.data(), common);
+    memset(out.data() + common, 0, size - common);
+
+    size_t next_page = 0;
+    while (ptr < end)
+    {
+        size_t gap;
+        if (!read_varint(ptr, end, gap))
+        {
+            return false;
+        }
+
+        const size_t page = next_page + gap;
+        next_page = page + 1;
+
+        const size_t offset = page * ST_DELTA_PAGE_SIZE;
+        if (offset >= size)
+        {
+            return false;
+        }
+        const size_t len = std::min(ST_DELTA_PAGE_SIZE, size - offset);
+
+        size_t pos = 0;
+        while (pos < len)
+        {
+            size_t zero_run;
+            size_t literal_len;
+            if (!read_varint(ptr, end, zero_run) || !read_varint(ptr, end, literal_len))
+            {
+                return false;
+            }
+
+            pos += zero_run;
+            if (pos > len || literal_len > len - pos || literal_len > static_cast<size_t>(end - ptr))
+            {
+                return false;
+            }
+
+            uint8_t* dest = out.data() + offset + pos;
+            for (size_t i = 0; i < literal_len; ++i)
+            {
+                dest[i] ^= ptr[i];
+            }
+
+            ptr += literal_len;
+            pos += literal_len;
+        }
+    }
+
+    return true;
+}
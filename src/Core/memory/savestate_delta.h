@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+/**
+ * The granularity at which savestate deltas are computed.
+ */
+constexpr size_t ST_DELTA_PAGE_SIZE = 0x1000;
+
+/**
+ * \brief Encodes a savestate buffer as a page-level delta against a base savestate buffer.
+ * Pages identical to the base are omitted, differing pages are stored as a run-length encoded XOR against the base.
+ * \param base The base buffer.
+ * \param target The buffer to encode.
+ * \param out The encoded delta. Existing contents are discarded.
+ */
+void st_delta_encode(std::span<const uint8_t> base, std::span<const uint8_t> target, std::vector<uint8_t>& out);
+
+/**
+ * \brief Reconstructs a savestate buffer from a base buffer and a delta produced by <c>st_delta_encode</c>.
+ * \param base The base buffer the delta was encoded against.
+ * \param delta The encoded delta.
+ * \param out The reconstructed buffer. Existing contents are discarded.
+ * \return Whether the delta was well-formed.
+ */
+bool st_delta_decode(std::span<const uint8_t> base, std::span<const uint8_t> delta, std::vector<uint8_t>& out);
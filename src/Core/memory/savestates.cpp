@@ -6,7 +6,6 @@
 
 #include "stdafx.h"
 #include "savestates.h"
-#include <libdeflate.h>
 #include <Core.h>
 #include <r4300/interrupt.h>
 #include <r4300/r4300.h>
@@ -15,6 +14,8 @@
 #include <IOHelpers.h>
 #include "flashram.h"
 #include "memory.h"
+#include "save_media.h"
+#include "savestate_container.h"
 #include "summercart.h"
 
 // st that comes from no delay fix mupen, it has some differences compared to new st:
@@ -47,7 +48,7 @@ std::recursive_mutex g_task_mutex;
 // The task vector, which contains the task queue to be performed by the savestate system.
 std::vector<t_savestate_task> g_tasks;
 
-// Demarcator for new screenshot section
+// Demarcator for the screenshot section in legacy savestates
 char screen_section[] = "SCR";
 
 // Buffer used for storing flashram data during loading
@@ -59,9 +60,92 @@ char g_event_queue_buf[1024]{};
 // Buffer used for storing st data up to event queue
 uint8_t g_first_block[0xA02BB4 - 32]{};
 
+// Layout of g_first_block, which mirrors the legacy savestate format
+constexpr size_t ST_HW_REGS_SIZE = sizeof(core_rdram_reg) + sizeof(core_mips_reg) + sizeof(core_pi_reg) + sizeof(core_sp_reg) + sizeof(core_rsp_reg) + sizeof(core_si_reg) + sizeof(core_vi_reg) + sizeof(core_ri_reg) + sizeof(core_ai_reg) + sizeof(core_dpc_reg) + sizeof(core_dps_reg);
+constexpr size_t ST_SI_REG_OFFSET = sizeof(core_rdram_reg) + sizeof(core_mips_reg) + sizeof(core_pi_reg) + sizeof(core_sp_reg) + sizeof(core_rsp_reg);
+constexpr size_t ST_RDRAM_OFFSET = ST_HW_REGS_SIZE;
+constexpr size_t ST_SP_MEM_OFFSET = ST_RDRAM_OFFSET + 0x800000;
+constexpr size_t ST_PIF_RAM_OFFSET = ST_SP_MEM_OFFSET + 0x2000;
+constexpr size_t ST_FLASHRAM_OFFSET = ST_PIF_RAM_OFFSET + 0x40;
+constexpr size_t ST_TLB_LUTS_OFFSET = ST_FLASHRAM_OFFSET + 24;
+constexpr size_t ST_CPU_OFFSET = ST_TLB_LUTS_OFFSET + 0x200000;
+constexpr size_t ST_CPU_SIZE = sizeof(g_first_block) - ST_CPU_OFFSET;
+
+static_assert(ST_SI_REG_OFFSET == 0xDC - 0x20);
+static_assert(ST_FLASHRAM_OFFSET == 0x8021F0 - 0x20);
+static_assert(ST_CPU_SIZE == 4 + 32 * 8 + 32 * 8 + 8 + 8 + 32 * 8 + 4 + 4 + 32 * sizeof(tlb) + 4 * 4);
+
+/// The parts of a savestate which aren't decoded directly into g_first_block and g_event_queue_buf.
+struct t_savestate_contents {
+    /// The hash of the ROM the savestate was created on.
+    char md5[33]{};
+
+    /// Whether the savestate contains a movie freeze buffer.
+    bool is_movie{};
+
+    /// The movie freeze buffer. Only valid if is_movie is true.
+    core_vcr_freeze_info freeze{};
+
+    /// The screen contents. Empty if the savestate has no screenshot. Points into the decoded savestate buffer.
+    std::span<const uint8_t> video_buffer{};
+    int32_t video_width{};
+    int32_t video_height{};
+};
+
 // The undo savestate buffer.
 std::vector<uint8_t> g_undo_savestate;
 
+// The page size used when patching memory regions into the in-memory snapshot image.
+constexpr size_t ST_SNAPSHOT_PAGE_SIZE = 0x1000;
+
+// The in-memory snapshot image, which is patched in place by memory-medium saves. Only accessed from the emu thread.
+std::vector<uint8_t> g_snapshot_image;
+
+// The checksum of each page of the memory regions in the in-memory snapshot image, in image order. Lets patches checksum only the pages they copied.
+std::vector<uint32_t> g_snapshot_page_crcs;
+
+// Scratch buffer for the registers section when patching the in-memory snapshot image.
+std::vector<uint8_t> g_snapshot_registers;
+
+// The raw contents of the savestate being loaded from a file. Only accessed from the emu thread.
+std::vector<uint8_t> g_load_file_buffer;
+
+// The decoded contents of the savestate being loaded. Only accessed from the emu thread.
+std::vector<uint8_t> g_load_decoded_buffer;
+
+// The amount of times a savestate buffer had to be allocated or grown.
+std::atomic<uint64_t> g_buffer_allocations;
+
+// The maximum amount of idle snapshot buffers kept around for reuse.
+constexpr size_t ST_BUFFER_POOL_MAX = 4;
+
+// The snapshot buffer pool mutex. Locked when accessing the buffer pool.
+std::mutex g_buffer_pool_mutex;
+
+// Idle snapshot buffers, which keep their capacity between saves.
+std::vector<std::shared_ptr<std::vector<uint8_t>>> g_buffer_pool;
+
+// The pending write mutex. Locked when accessing the pending write state, but never while writing a savestate file.
+std::mutex g_pending_writes_mutex;
+
+// Serializes the writes to a path, keyed by path. Held while writing the file so writes to other paths and enqueueing don't wait on disk I/O.
+std::unordered_map<std::filesystem::path, std::shared_ptr<std::mutex>> g_path_write_mutexes;
+
+// Signaled whenever a pending write completes.
+std::condition_variable g_pending_writes_cv;
+
+// The amount of writes which haven't completed yet, keyed by path.
+std::unordered_map<std::filesystem::path, size_t> g_pending_writes;
+
+// The ticket of the most recently enqueued write, keyed by path.
+std::unordered_map<std::filesystem::path, uint64_t> g_last_enqueued_write;
+
+// The ticket of the most recently completed write, keyed by path. Older writes which complete later are discarded.
+std::unordered_map<std::filesystem::path, uint64_t> g_last_completed_write;
+
+// The ticket assigned to the next write.
+uint64_t g_next_write_ticket = 1;
+
 void get_paths_for_task(const t_savestate_task& task, std::filesystem::path& st_path, std::filesystem::path& sd_path)
 {
     sd_path = g_core->get_saves_directory() / (const char*)ROM_HEADER.nom;
@@ -108,7 +192,12 @@ void load_memory_from_buffer(uint8_t* p)
     memread(&p, &FCR31, 4);
     memread(&p, tlb_e, 32 * sizeof(tlb));
     if (!dynacore && interpcore)
+    {
         memread(&p, &interp_addr, 4);
+        // The TLB may map pages differently now
+        for (char& i : invalid_code)
+            i = 1;
+    }
     else
     {
         uint32_t target_addr;
@@ -123,23 +212,177 @@ void load_memory_from_buffer(uint8_t* p)
     memread(&p, &vi_field, 4);
 }
 
-std::vector<uint8_t> generate_savestate()
+/**
+ * Takes a snapshot buffer from the pool, or allocates a new one if the pool is empty.
+ */
+std::shared_ptr<std::vector<uint8_t>> st_acquire_buffer()
 {
-    std::vector<uint8_t> b;
+    std::scoped_lock lock(g_buffer_pool_mutex);
 
-    b.reserve(0xB624F0);
+    if (g_buffer_pool.empty())
+    {
+        ++g_buffer_allocations;
+        auto buf = std::make_shared<std::vector<uint8_t>>();
+        buf->reserve(0xB624F0);
+        return buf;
+    }
 
-    memset(g_flashram_buf, 0, sizeof(g_flashram_buf));
-    memset(g_event_queue_buf, 0, sizeof(g_event_queue_buf));
+    auto buf = g_buffer_pool.back();
+    g_buffer_pool.pop_back();
+    return buf;
+}
 
-    core_vcr_freeze_info freeze{};
-    uint32_t movie_active = core_vcr_freeze(&freeze);
+/**
+ * Returns a snapshot buffer to the pool.
+ */
+void st_release_buffer(const std::shared_ptr<std::vector<uint8_t>>& buf)
+{
+    std::scoped_lock lock(g_buffer_pool_mutex);
 
-    // NOTE: This saving needs to be done **after** the fixing block, as it is now. See previous regression in f9d58f639c798cbc26bbb808b1c3dbd834ffe2d9.
-    save_flashram_infos(g_flashram_buf);
-    const int32_t event_queue_len = save_eventqueue_infos(g_event_queue_buf);
+    if (g_buffer_pool.size() < ST_BUFFER_POOL_MAX)
+    {
+        buf->clear();
+        g_buffer_pool.push_back(buf);
+    }
+}
+
+/**
+ * Counts an allocation if a buffer's capacity grew past the specified value.
+ */
+void st_track_capacity(const std::vector<uint8_t>& buf, const size_t previous_capacity)
+{
+    if (buf.capacity() > previous_capacity)
+    {
+        ++g_buffer_allocations;
+    }
+}
+
+/**
+ * Blocks until all pending writes to the specified path have completed. If the path is empty, waits for all pending writes.
+ */
+void st_wait_for_pending_writes(const std::filesystem::path& path)
+{
+    std::unique_lock lock(g_pending_writes_mutex);
+    g_pending_writes_cv.wait(lock, [&] {
+        return path.empty() ? g_pending_writes.empty() : !g_pending_writes.contains(path);
+    });
+}
+
+/**
+ * Registers a pending write to the specified path, so loads from it wait until st_write_async has written it.
+ * \return The write's ticket.
+ */
+uint64_t st_begin_write(const std::filesystem::path& path)
+{
+    std::scoped_lock lock(g_pending_writes_mutex);
+    const auto ticket = g_next_write_ticket++;
+    g_pending_writes[path]++;
+    g_last_enqueued_write[path] = ticket;
+    return ticket;
+}
+
+/**
+ * Compresses a savestate and writes it to the specified path on the host's executor. Failures are reported to the user.
+ * Writes to the same path land in the order they were registered with st_begin_write.
+ */
+void st_write_async(const std::filesystem::path& path, const std::shared_ptr<std::vector<uint8_t>>& st, const uint64_t ticket)
+{
+    g_core->submit_task([=] {
+        // Generate compressed buffer
+        const auto compressed_buffer = st_acquire_buffer();
+        const auto capacity = compressed_buffer->capacity();
+        st_container_compress(*st, *compressed_buffer);
+        st_track_capacity(*compressed_buffer, capacity);
+
+        std::shared_ptr<std::mutex> path_mutex;
+        {
+            std::scoped_lock lock(g_pending_writes_mutex);
+            auto& mutex = g_path_write_mutexes[path];
+            if (!mutex)
+            {
+                mutex = std::make_shared<std::mutex>();
+            }
+            path_mutex = mutex;
+        }
+
+        bool written = true;
+        {
+            std::scoped_lock path_lock(*path_mutex);
+
+            bool superseded;
+            {
+                std::scoped_lock lock(g_pending_writes_mutex);
+                // A newer write to the same path has already landed, so this one would clobber it.
+                superseded = g_last_completed_write[path] > ticket;
+            }
+
+            if (superseded)
+            {
+                g_core->log_trace(std::format(L"[ST] Discarding superseded write to {}", path.wstring()));
+            }
+            else
+            {
+                written = write_file_buffer(path, *compressed_buffer);
+
+                std::scoped_lock lock(g_pending_writes_mutex);
+                g_last_completed_write[path] = ticket;
+            }
+        }
+
+        if (!written)
+        {
+            g_core->log_error(std::format(L"[ST] Failed to write savestate to {}", path.wstring()));
+            g_core->show_dialog(std::format(L"Failed to write savestate to {}.", path.wstring()).c_str(), L"Savestate", fsvc_error);
+        }
+
+        st_release_buffer(st);
+        st_release_buffer(compressed_buffer);
+
+        {
+            std::scoped_lock lock(g_pending_writes_mutex);
+            if (--g_pending_writes[path] == 0)
+            {
+                g_pending_writes.erase(path);
+                g_path_write_mutexes.erase(path);
+                if (g_last_enqueued_write[path] == ticket)
+                {
+                    g_last_enqueued_write.erase(path);
+                    g_last_completed_write.erase(path);
+                }
+            }
+        }
+        g_pending_writes_cv.notify_all();
+    });
+}
+
+/**
+ * A memory region which is captured as part of a savestate section.
+ */
+struct t_st_memory_region {
+    core_st_section section;
+    const void* ptr;
+    size_t size;
+};
+
+/**
+ * Gets the memory regions captured by the savestate, in the order they're written in.
+ */
+static std::array<t_st_memory_region, 5> get_memory_regions()
+{
+    return {{
+    {core_st_section_rdram, rdram, 0x800000},
+    {core_st_section_sp_memory, SP_DMEM, 0x1000},
+    {core_st_section_sp_memory, SP_IMEM, 0x1000},
+    {core_st_section_tlb_luts, tlb_LUT_r, 0x100000},
+    {core_st_section_tlb_luts, tlb_LUT_w, 0x100000},
+    }};
+}
 
-    vecwrite(b, rom_md5, 32);
+/**
+ * Writes the registers section's data.
+ */
+static void write_registers(std::vector<uint8_t>& b)
+{
     vecwrite(b, &rdram_register, sizeof(core_rdram_reg));
     vecwrite(b, &MI_register, sizeof(core_mips_reg));
     vecwrite(b, &pi_register, sizeof(core_pi_reg));
@@ -151,13 +394,8 @@ std::vector<uint8_t> generate_savestate()
     vecwrite(b, &ai_register, sizeof(core_ai_reg));
     vecwrite(b, &dpc_register, sizeof(core_dpc_reg));
     vecwrite(b, &dps_register, sizeof(core_dps_reg));
-    vecwrite(b, rdram, 0x800000);
-    vecwrite(b, SP_DMEM, 0x1000);
-    vecwrite(b, SP_IMEM, 0x1000);
     vecwrite(b, PIF_RAM, 0x40);
     vecwrite(b, g_flashram_buf, 24);
-    vecwrite(b, tlb_LUT_r, 0x100000);
-    vecwrite(b, tlb_LUT_w, 0x100000);
     vecwrite(b, &llbit, 4);
     vecwrite(b, reg, 32 * 8);
     for (size_t i = 0; i < 32; i++)
@@ -175,8 +413,171 @@ std::vector<uint8_t> generate_savestate()
     vecwrite(b, &next_interrupt, 4);
     vecwrite(b, &next_vi, 4);
     vecwrite(b, &vi_field, 4);
+}
+
+/**
+ * Copies the pages of a memory region which differ from the destination and recomputes their checksums.
+ * \param crcs The checksums of the destination's pages.
+ * \return Whether any page was copied.
+ */
+static bool copy_dirty_pages(uint8_t* dst, const uint8_t* src, const size_t size, uint32_t* crcs)
+{
+    bool dirty = false;
+    for (size_t offset = 0; offset < size; offset += ST_SNAPSHOT_PAGE_SIZE)
+    {
+        if (memcmp(dst + offset, src + offset, ST_SNAPSHOT_PAGE_SIZE))
+        {
+            memcpy(dst + offset, src + offset, ST_SNAPSHOT_PAGE_SIZE);
+            crcs[offset / ST_SNAPSHOT_PAGE_SIZE] = st_container_crc32({dst + offset, ST_SNAPSHOT_PAGE_SIZE});
+            dirty = true;
+        }
+    }
+    return dirty;
+}
+
+/**
+ * Recomputes the page checksums of the in-memory snapshot image from the current memory regions.
+ */
+static void reset_snapshot_page_crcs()
+{
+    g_snapshot_page_crcs.clear();
+    for (const auto& region : get_memory_regions())
+    {
+        for (size_t offset = 0; offset < region.size; offset += ST_SNAPSHOT_PAGE_SIZE)
+        {
+            g_snapshot_page_crcs.push_back(st_container_crc32({(const uint8_t*)region.ptr + offset, ST_SNAPSHOT_PAGE_SIZE}));
+        }
+    }
+}
+
+/**
+ * Updates the registers and memory sections of a savestate previously generated into the buffer in place, only copying the memory pages which changed since then.
+ * Truncates the buffer after the memory sections.
+ * \return Whether the buffer could be patched. If false, the buffer is left untouched and must be regenerated from scratch.
+ */
+static bool patch_savestate(std::vector<uint8_t>& b)
+{
+    t_st_container_header header;
+    if (!st_container_read_header(b, header) || memcmp(header.rom_md5, rom_md5, sizeof(header.rom_md5)))
+    {
+        return false;
+    }
+
+    g_snapshot_registers.clear();
+    write_registers(g_snapshot_registers);
+
+    // Validate the whole layout up front so we never leave a partially patched buffer behind
+    size_t regs_offset, regs_size;
+    if (!st_container_locate_section(b, core_st_section_registers, regs_offset, regs_size) || regs_size != g_snapshot_registers.size())
+    {
+        return false;
+    }
+
+    const auto regions = get_memory_regions();
+    size_t end = 0;
+    size_t page_count = 0;
+    for (size_t i = 0; i < regions.size();)
+    {
+        const auto section = regions[i].section;
+        size_t section_size = 0;
+        for (; i < regions.size() && regions[i].section == section; ++i)
+        {
+            assert(regions[i].size % ST_SNAPSHOT_PAGE_SIZE == 0);
+            section_size += regions[i].size;
+        }
+        page_count += section_size / ST_SNAPSHOT_PAGE_SIZE;
+
+        size_t offset, size;
+        if (!st_container_locate_section(b, section, offset, size) || size != section_size)
+        {
+            return false;
+        }
+        end = offset + size;
+    }
+
+    if (g_snapshot_page_crcs.size() != page_count)
+    {
+        return false;
+    }
+
+    memcpy(b.data() + regs_offset, g_snapshot_registers.data(), regs_size);
+    st_container_refresh_section(b, core_st_section_registers);
+
+    size_t page = 0;
+    for (size_t i = 0; i < regions.size();)
+    {
+        const auto section = regions[i].section;
+        size_t offset, size;
+        st_container_locate_section(b, section, offset, size);
+
+        const size_t first_page = page;
+        bool dirty = false;
+        for (; i < regions.size() && regions[i].section == section; ++i)
+        {
+            dirty |= copy_dirty_pages(b.data() + offset, (const uint8_t*)regions[i].ptr, regions[i].size, g_snapshot_page_crcs.data() + page);
+            offset += regions[i].size;
+            page += regions[i].size / ST_SNAPSHOT_PAGE_SIZE;
+        }
+
+        // The section checksum is derived from the page checksums, so only the copied pages are checksummed again
+        if (dirty)
+        {
+            st_container_set_section_crc32(b, section, st_container_concat_crc32({g_snapshot_page_crcs.data() + first_page, page - first_page}, ST_SNAPSHOT_PAGE_SIZE));
+        }
+    }
+
+    b.resize(end);
+    return true;
+}
+
+/**
+ * Generates a savestate into the specified buffer.
+ * \param b The target buffer.
+ * \param incremental Whether the buffer holds a savestate previously generated by this function which should be patched in place instead of being rewritten.
+ */
+void generate_savestate(std::vector<uint8_t>& b, const bool incremental = false)
+{
+    memset(g_flashram_buf, 0, sizeof(g_flashram_buf));
+    memset(g_event_queue_buf, 0, sizeof(g_event_queue_buf));
+
+    core_vcr_freeze_info freeze{};
+    uint32_t movie_active = core_vcr_freeze(&freeze);
+
+    // NOTE: This saving needs to be done **after** the fixing block, as it is now. See previous regression in f9d58f639c798cbc26bbb808b1c3dbd834ffe2d9.
+    save_flashram_infos(g_flashram_buf);
+    const int32_t event_queue_len = save_eventqueue_infos(g_event_queue_buf);
+
+    if (!incremental || !patch_savestate(b))
+    {
+        st_container_begin(b, rom_md5);
+
+        st_container_begin_section(b, core_st_section_registers);
+        write_registers(b);
+        st_container_end_section(b, core_st_section_registers);
+
+        const auto regions = get_memory_regions();
+        for (size_t i = 0; i < regions.size();)
+        {
+            const auto section = regions[i].section;
+            st_container_begin_section(b, section);
+            for (; i < regions.size() && regions[i].section == section; ++i)
+            {
+                vecwrite(b, (void*)regions[i].ptr, regions[i].size);
+            }
+            st_container_end_section(b, section);
+        }
+
+        if (incremental)
+        {
+            reset_snapshot_page_crcs();
+        }
+    }
+
+    st_container_begin_section(b, core_st_section_event_queue);
     vecwrite(b, g_event_queue_buf, event_queue_len);
-    vecwrite(b, &movie_active, sizeof(movie_active));
+    st_container_end_section(b, core_st_section_event_queue);
+
+    st_container_begin_section(b, core_st_section_vcr_freeze);
     if (movie_active)
     {
         vecwrite(b, &freeze.size, sizeof(freeze.size));
@@ -186,7 +587,9 @@ std::vector<uint8_t> generate_savestate()
         vecwrite(b, &freeze.length_samples, sizeof(freeze.length_samples));
         vecwrite(b, freeze.input_buffer.data(), freeze.input_buffer.size() * sizeof(core_buttons));
     }
+    st_container_end_section(b, core_st_section_vcr_freeze);
 
+    st_container_begin_section(b, core_st_section_screenshot);
     if (core_vr_get_mge_available() && g_core->cfg->st_screenshot)
     {
         int32_t width;
@@ -194,69 +597,241 @@ std::vector<uint8_t> generate_savestate()
         g_core->plugin_funcs.video_get_video_size(&width, &height);
         g_core->log_trace(std::format(L"Writing screen buffer to savestate, width: {}, height: {}", width, height));
 
-        void* video = malloc(width * height * 3);
-        g_core->copy_video(video);
-
-        vecwrite(b, screen_section, sizeof(screen_section));
         vecwrite(b, &width, sizeof(width));
         vecwrite(b, &height, sizeof(height));
-        vecwrite(b, video, width * height * 3);
 
-        free(video);
+        // Capture straight into the savestate to avoid a temporary buffer
+        const size_t video_offset = b.size();
+        b.resize(video_offset + static_cast<size_t>(width) * height * 3);
+        g_core->copy_video(b.data() + video_offset);
     }
-
-    return b;
+    st_container_end_section(b, core_st_section_screenshot);
 }
 
 void savestates_save_immediate_impl(const t_savestate_task& task)
 {
     // TODO: Reimplement timing
 
-    const auto st = generate_savestate();
-
-    if (task.medium == core_st_medium_path)
+    if (task.medium == core_st_medium_memory)
     {
-        // Always save summercart for some reason
-        std::filesystem::path new_st_path = task.params.path;
-        std::filesystem::path new_sd_path = "";
-        get_paths_for_task(task, new_st_path, new_sd_path);
-        if (g_core->cfg->use_summercart)
-            save_summercart(new_sd_path);
+        // Memory saves are frequent (undo points, seek savestates, scripts) and usually differ only by a few pages, so we patch the previous snapshot instead of rebuilding it.
+        const auto capacity = g_snapshot_image.capacity();
+        generate_savestate(g_snapshot_image, true);
+        st_track_capacity(g_snapshot_image, capacity);
 
-        // Generate compressed buffer
-        std::vector<uint8_t> compressed_buffer;
-        compressed_buffer.resize(st.size());
+        task.callback(core_st_callback_info{
+                      .result = Res_Ok,
+                      .job = task.job,
+                      .medium = task.medium,
+                      .params = task.params},
+                      g_snapshot_image);
+        g_core->callbacks.save_state();
+        return;
+    }
 
-        const auto compressor = libdeflate_alloc_compressor(6);
-        const size_t final_size = libdeflate_gzip_compress(compressor, st.data(), st.size(), compressed_buffer.data(), compressed_buffer.size());
-        libdeflate_free_compressor(compressor);
-        compressed_buffer.resize(final_size);
+    // NOTE: Compression and disk I/O for path tasks are deferred to the host's executor.
+    assert(task.medium == core_st_medium_path);
 
-        // write compressed st to disk
-        FILE* f = nullptr;
+    const auto st = st_acquire_buffer();
+    const auto capacity = st->capacity();
+    generate_savestate(*st);
+    st_track_capacity(*st, capacity);
 
-        if (fopen_s(&f, new_st_path.string().c_str(), "wb"))
-        {
-            task.callback(core_st_callback_info{
-                          .result = ST_FileWriteError,
-                          .job = task.job,
-                          .medium = task.medium,
-                          .params = task.params},
-                          st);
-            return;
-        }
+    // Always save summercart for some reason
+    std::filesystem::path new_st_path = task.params.path;
+    std::filesystem::path new_sd_path = "";
+    get_paths_for_task(task, new_st_path, new_sd_path);
+    if (g_core->cfg->use_summercart)
+        save_summercart(new_sd_path);
 
-        fwrite(compressed_buffer.data(), compressed_buffer.size(), 1, f);
-        fclose(f);
-    }
+    // Savestates on disk are a natural checkpoint, so the save data is persisted alongside them
+    save_media_flush(true);
+
+    // The callback runs on the emu thread right after the snapshot, as callers (e.g. VCR starting a recording from a snapshot) rely on no frames passing in between.
+    // Only the file write is deferred, and loads from the path wait for it.
+    const auto ticket = st_begin_write(new_st_path);
 
     task.callback(core_st_callback_info{
                   .result = Res_Ok,
                   .job = task.job,
                   .medium = task.medium,
                   .params = task.params},
-                  st);
+                  *st);
     g_core->callbacks.save_state();
+
+    st_write_async(new_st_path, st, ticket);
+}
+
+/**
+ * Decodes a legacy savestate, which is a positional blob of the emulator state.
+ */
+core_result decode_legacy_savestate(std::vector<uint8_t>& buf, t_savestate_contents& contents)
+{
+    // BUG (PRONE): we arent allowed to hold on to a vector element pointer
+    // find another way of doing this
+    auto ptr = buf.data();
+
+    memread(&ptr, contents.md5, 32);
+
+    // new version does one bigass gzread for first part of .st (static size)
+    memread(&ptr, g_first_block, sizeof(g_first_block));
+
+    // now read interrupt queue into buf
+    int32_t len;
+    for (len = 0; len < sizeof(g_event_queue_buf); len += 8)
+    {
+        memread(&ptr, g_event_queue_buf + len, 4);
+        if (*reinterpret_cast<uint32_t*>(&g_event_queue_buf[len]) == 0xFFFFFFFF)
+            break;
+        memread(&ptr, g_event_queue_buf + len + 4, 4);
+    }
+    if (len == sizeof(g_event_queue_buf))
+    {
+        // Exhausted the buffer and still no terminator. Prevents the buffer overflow "Queuecrush".
+        return ST_EventQueueTooLong;
+    }
+
+    uint32_t is_movie;
+    memread(&ptr, &is_movie, sizeof(is_movie));
+    contents.is_movie = is_movie;
+
+    if (is_movie)
+    {
+        auto& freeze = contents.freeze;
+
+        memread(&ptr, &freeze.size, sizeof(freeze.size));
+        memread(&ptr, &freeze.uid, sizeof(freeze.uid));
+        memread(&ptr, &freeze.current_sample, sizeof(freeze.current_sample));
+        memread(&ptr, &freeze.current_vi, sizeof(freeze.current_vi));
+        memread(&ptr, &freeze.length_samples, sizeof(freeze.length_samples));
+
+        freeze.input_buffer.resize(sizeof(core_buttons) * (freeze.length_samples + 1));
+        memread(&ptr, freeze.input_buffer.data(), freeze.input_buffer.size());
+    }
+
+    g_core->log_trace(std::format(L"[Savestates] {} bytes remaining", buf.size() - (ptr - buf.data())));
+    if (buf.size() - (ptr - buf.data()) > 0)
+    {
+        char scr_section[sizeof(screen_section)] = {0};
+        memread(&ptr, scr_section, sizeof(screen_section));
+
+        if (!memcmp(scr_section, screen_section, sizeof(screen_section)))
+        {
+            g_core->log_trace(std::format(L"[Savestates] Restoring screen buffer..."));
+            memread(&ptr, &contents.video_width, sizeof(contents.video_width));
+            memread(&ptr, &contents.video_height, sizeof(contents.video_height));
+
+            const size_t video_size = static_cast<size_t>(contents.video_width) * contents.video_height * 3;
+            if (contents.video_width > 0 && contents.video_height > 0 && buf.size() - (ptr - buf.data()) >= video_size)
+            {
+                contents.video_buffer = std::span(ptr, video_size);
+                ptr += video_size;
+            }
+        }
+    }
+
+    return Res_Ok;
+}
+
+/**
+ * Decodes an uncompressed sectioned savestate. The sections are reassembled into the legacy memory block layout.
+ */
+core_result decode_sectioned_savestate(std::span<const uint8_t> buf, t_savestate_contents& contents)
+{
+    t_st_container_header header{};
+    if (!st_container_read_header(buf, header))
+    {
+        return ST_DecompressionError;
+    }
+    memcpy(contents.md5, header.rom_md5, sizeof(header.rom_md5));
+
+    std::span<const uint8_t> section;
+    core_result result;
+
+#define GET_SECTION(id, expected_size)                                       \
+    result = st_container_get_section(buf, id, section);                     \
+    if (result != Res_Ok)                                                    \
+        return result;                                                       \
+    if ((expected_size) != SIZE_MAX && section.size() != (expected_size))    \
+        return ST_DecompressionError;
+
+    GET_SECTION(core_st_section_registers, ST_HW_REGS_SIZE + 0x40 + 24 + ST_CPU_SIZE)
+    auto ptr = section.data();
+    memcpy(g_first_block, ptr, ST_HW_REGS_SIZE);
+    ptr += ST_HW_REGS_SIZE;
+    memcpy(g_first_block + ST_PIF_RAM_OFFSET, ptr, 0x40 + 24);
+    ptr += 0x40 + 24;
+    memcpy(g_first_block + ST_CPU_OFFSET, ptr, ST_CPU_SIZE);
+
+    GET_SECTION(core_st_section_rdram, 0x800000)
+    memcpy(g_first_block + ST_RDRAM_OFFSET, section.data(), section.size());
+
+    GET_SECTION(core_st_section_sp_memory, 0x2000)
+    memcpy(g_first_block + ST_SP_MEM_OFFSET, section.data(), section.size());
+
+    GET_SECTION(core_st_section_tlb_luts, 0x200000)
+    memcpy(g_first_block + ST_TLB_LUTS_OFFSET, section.data(), section.size());
+
+    GET_SECTION(core_st_section_event_queue, SIZE_MAX)
+    if (section.size() > sizeof(g_event_queue_buf) || section.size() % 8 != 4 || *reinterpret_cast<const uint32_t*>(section.data() + section.size() - 4) != 0xFFFFFFFF)
+    {
+        return ST_EventQueueTooLong;
+    }
+    memcpy(g_event_queue_buf, section.data(), section.size());
+
+#undef GET_SECTION
+
+    result = st_container_get_section(buf, core_st_section_vcr_freeze, section);
+    if (result == Res_Ok)
+    {
+        auto& freeze = contents.freeze;
+        constexpr size_t freeze_header_size = sizeof(freeze.size) + sizeof(freeze.uid) + sizeof(freeze.current_sample) + sizeof(freeze.current_vi) + sizeof(freeze.length_samples);
+
+        if (section.size() < freeze_header_size)
+        {
+            return VCR_InvalidFormat;
+        }
+
+        ptr = section.data();
+        memcpy(&freeze.size, ptr, sizeof(freeze.size));
+        memcpy(&freeze.uid, ptr + 4, sizeof(freeze.uid));
+        memcpy(&freeze.current_sample, ptr + 8, sizeof(freeze.current_sample));
+        memcpy(&freeze.current_vi, ptr + 12, sizeof(freeze.current_vi));
+        memcpy(&freeze.length_samples, ptr + 16, sizeof(freeze.length_samples));
+
+        if ((section.size() - freeze_header_size) / sizeof(core_buttons) < static_cast<size_t>(freeze.length_samples) + 1)
+        {
+            return VCR_InvalidFormat;
+        }
+
+        freeze.input_buffer.resize(freeze.length_samples + 1);
+        memcpy(freeze.input_buffer.data(), ptr + freeze_header_size, freeze.input_buffer.size() * sizeof(core_buttons));
+        contents.is_movie = true;
+    }
+    else if (result != ST_SectionNotFound)
+    {
+        return result;
+    }
+
+    result = st_container_get_section(buf, core_st_section_screenshot, section);
+    if (result == Res_Ok && section.size() >= sizeof(int32_t) * 2)
+    {
+        memcpy(&contents.video_width, section.data(), sizeof(contents.video_width));
+        memcpy(&contents.video_height, section.data() + sizeof(int32_t), sizeof(contents.video_height));
+
+        const size_t video_size = static_cast<size_t>(contents.video_width) * contents.video_height * 3;
+        if (contents.video_width > 0 && contents.video_height > 0 && section.size() - sizeof(int32_t) * 2 == video_size)
+        {
+            g_core->log_trace(std::format(L"[Savestates] Restoring screen buffer..."));
+            contents.video_buffer = section.subspan(sizeof(int32_t) * 2);
+        }
+    }
+    else if (result != Res_Ok && result != ST_SectionNotFound)
+    {
+        return result;
+    }
+
+    return Res_Ok;
 }
 
 void savestates_load_immediate_impl(const t_savestate_task& task)
@@ -272,13 +847,19 @@ void savestates_load_immediate_impl(const t_savestate_task& task)
     if (g_core->cfg->use_summercart)
         load_summercart(new_sd_path);
 
-    std::vector<uint8_t> st_buf;
+    std::span<const uint8_t> st_buf;
 
     switch (task.medium)
     {
     case core_st_medium_path:
-        st_buf = read_file_buffer(new_st_path);
-        break;
+        {
+            st_wait_for_pending_writes(new_st_path);
+            const auto capacity = g_load_file_buffer.capacity();
+            read_file_buffer(new_st_path, g_load_file_buffer);
+            st_track_capacity(g_load_file_buffer, capacity);
+            st_buf = g_load_file_buffer;
+            break;
+        }
     case core_st_medium_memory:
         st_buf = task.params.buffer;
         break;
@@ -297,11 +878,34 @@ void savestates_load_immediate_impl(const t_savestate_task& task)
         return;
     }
 
-    std::vector<uint8_t> decompressed_buf = auto_decompress(st_buf);
-    if (decompressed_buf.empty())
+    auto& decompressed_buf = g_load_decoded_buffer;
+    const auto decompressed_capacity = decompressed_buf.capacity();
+    core_result decode_result = Res_Ok;
+
+    if (st_container_is_sectioned(st_buf))
+    {
+        decode_result = st_container_decompress(st_buf, decompressed_buf);
+    }
+    else if (!auto_decompress(st_buf, decompressed_buf) || decompressed_buf.empty())
+    {
+        decode_result = ST_DecompressionError;
+    }
+
+    st_track_capacity(decompressed_buf, decompressed_capacity);
+
+    t_savestate_contents contents{};
+
+    if (decode_result == Res_Ok)
+    {
+        decode_result = st_container_is_sectioned(decompressed_buf)
+        ? decode_sectioned_savestate(decompressed_buf, contents)
+        : decode_legacy_savestate(decompressed_buf, contents);
+    }
+
+    if (decode_result != Res_Ok)
     {
         task.callback(core_st_callback_info{
-                      .result = ST_DecompressionError,
+                      .result = decode_result,
                       .job = task.job,
                       .medium = task.medium,
                       .params = task.params},
@@ -309,17 +913,10 @@ void savestates_load_immediate_impl(const t_savestate_task& task)
         return;
     }
 
-    // BUG (PRONE): we arent allowed to hold on to a vector element pointer
-    // find another way of doing this
-    auto ptr = decompressed_buf.data();
-
     // compare current rom hash with one stored in state
-    char md5[33] = {0};
-    memread(&ptr, &md5, 32);
-
-    if (!task.ignore_warnings && memcmp(md5, rom_md5, 32))
+    if (!task.ignore_warnings && memcmp(contents.md5, rom_md5, 32))
     {
-        auto result = g_core->show_ask_dialog(CORE_DLG_ST_HASH_MISMATCH, std::format(L"The savestate was created on a rom with hash {}, but is being loaded on another rom.\r\nThe emulator may crash. Are you sure you want to continue?", string_to_wstring(md5)).c_str(), L"Savestate", true);
+        auto result = g_core->show_ask_dialog(CORE_DLG_ST_HASH_MISMATCH, std::format(L"The savestate was created on a rom with hash {}, but is being loaded on another rom.\r\nThe emulator may crash. Are you sure you want to continue?", string_to_wstring(contents.md5)).c_str(), L"Savestate", true);
 
         if (!result)
         {
@@ -333,11 +930,8 @@ void savestates_load_immediate_impl(const t_savestate_task& task)
         }
     }
 
-    // new version does one bigass gzread for first part of .st (static size)
-    memread(&ptr, g_first_block, sizeof(g_first_block));
-
-    const auto si_reg = (core_si_reg*)&g_first_block[0xDC - 0x20];
-    if (!check_register_validity(si_reg) || !check_flashram_infos(&g_first_block[0x8021F0 - 0x20]))
+    const auto si_reg = (core_si_reg*)&g_first_block[ST_SI_REG_OFFSET];
+    if (!check_register_validity(si_reg) || !check_flashram_infos(&g_first_block[ST_FLASHRAM_OFFSET]))
     {
         task.callback(core_st_callback_info{
                       .result = ST_InvalidRegisters,
@@ -348,46 +942,11 @@ void savestates_load_immediate_impl(const t_savestate_task& task)
         return;
     }
 
-    // now read interrupt queue into buf
-    int32_t len;
-    for (len = 0; len < sizeof(g_event_queue_buf); len += 8)
-    {
-        memread(&ptr, g_event_queue_buf + len, 4);
-        if (*reinterpret_cast<uint32_t*>(&g_event_queue_buf[len]) == 0xFFFFFFFF)
-            break;
-        memread(&ptr, g_event_queue_buf + len + 4, 4);
-    }
-    if (len == sizeof(g_event_queue_buf))
-    {
-        // Exhausted the buffer and still no terminator. Prevents the buffer overflow "Queuecrush".
-        task.callback(core_st_callback_info{
-                      .result = ST_EventQueueTooLong,
-                      .job = task.job,
-                      .medium = task.medium,
-                      .params = task.params},
-                      {});
-        return;
-    }
-
-    uint32_t is_movie;
-    memread(&ptr, &is_movie, sizeof(is_movie));
-
-    if (is_movie)
+    if (contents.is_movie)
     {
         // this .st is part of a movie, we need to overwrite our current movie buffer
         // hash matches, load and verify rest of the data
-        core_vcr_freeze_info freeze{};
-
-        memread(&ptr, &freeze.size, sizeof(freeze.size));
-        memread(&ptr, &freeze.uid, sizeof(freeze.uid));
-        memread(&ptr, &freeze.current_sample, sizeof(freeze.current_sample));
-        memread(&ptr, &freeze.current_vi, sizeof(freeze.current_vi));
-        memread(&ptr, &freeze.length_samples, sizeof(freeze.length_samples));
-
-        freeze.input_buffer.resize(sizeof(core_buttons) * (freeze.length_samples + 1));
-        memread(&ptr, freeze.input_buffer.data(), freeze.input_buffer.size());
-
-        const auto code = core_vcr_unfreeze(freeze);
+        const auto code = core_vcr_unfreeze(contents.freeze);
 
         if (!task.ignore_warnings && code != Res_Ok && core_vcr_get_task() != task_idle)
         {
@@ -445,41 +1004,18 @@ void savestates_load_immediate_impl(const t_savestate_task& task)
         // at this point we know the savestate is safe to be loaded (done after else block)
     }
 
+    // so far loading success! overwrite memory
+    load_eventqueue_infos(g_event_queue_buf);
+    load_memory_from_buffer(g_first_block);
+
+    // NOTE: We don't want to restore screen buffer while seeking, since it creates a int16_t ugly flicker when the movie restarts by loading state
+    if (core_vr_get_mge_available() && !contents.video_buffer.empty() && !core_vcr_is_seeking())
     {
-        g_core->log_trace(std::format(L"[Savestates] {} bytes remaining", decompressed_buf.size() - (ptr - decompressed_buf.data())));
-        int32_t video_width = 0;
-        int32_t video_height = 0;
-        void* video_buffer = nullptr;
-        if (decompressed_buf.size() - (ptr - decompressed_buf.data()) > 0)
+        int32_t current_width, current_height;
+        g_core->plugin_funcs.video_get_video_size(&current_width, &current_height);
+        if (current_width == contents.video_width && current_height == contents.video_height)
         {
-            char scr_section[sizeof(screen_section)] = {0};
-            memread(&ptr, scr_section, sizeof(screen_section));
-
-            if (!memcmp(scr_section, screen_section, sizeof(screen_section)))
-            {
-                g_core->log_trace(std::format(L"[Savestates] Restoring screen buffer..."));
-                memread(&ptr, &video_width, sizeof(video_width));
-                memread(&ptr, &video_height, sizeof(video_height));
-
-                video_buffer = malloc(video_width * video_height * 3);
-                memread(&ptr, video_buffer, video_width * video_height * 3);
-            }
-        }
-
-        // so far loading success! overwrite memory
-        load_eventqueue_infos(g_event_queue_buf);
-        load_memory_from_buffer(g_first_block);
-
-        // NOTE: We don't want to restore screen buffer while seeking, since it creates a int16_t ugly flicker when the movie restarts by loading state
-        if (core_vr_get_mge_available() && video_buffer && !core_vcr_is_seeking())
-        {
-            int32_t current_width, current_height;
-            g_core->plugin_funcs.video_get_video_size(&current_width, &current_height);
-            if (current_width == video_width && current_height == video_height)
-            {
-                g_core->load_screen(video_buffer);
-                free(video_buffer);
-            }
+            g_core->load_screen(const_cast<uint8_t*>(contents.video_buffer.data()));
         }
     }
 
@@ -692,9 +1228,15 @@ void st_do_work()
 
 void st_on_core_stop()
 {
+    st_wait_for_pending_writes({});
+
     std::scoped_lock lock(g_task_mutex);
     g_tasks.clear();
     g_undo_savestate.clear();
+    g_snapshot_image = {};
+    g_snapshot_page_crcs = {};
+    g_load_file_buffer = {};
+    g_load_decoded_buffer = {};
 }
 
 /**
@@ -790,3 +1332,19 @@ void core_st_get_undo_savestate(std::vector<uint8_t>& buffer)
     buffer.clear();
     buffer = g_undo_savestate;
 }
+
+uint64_t core_st_get_allocation_count()
+{
+    return g_buffer_allocations;
+}
+
+void core_st_wait_for_writes(const std::filesystem::path& path)
+{
+    st_wait_for_pending_writes(path);
+}
+
+core_result core_st_read_section(const std::filesystem::path& path, const core_st_section section, std::vector<uint8_t>& buffer)
+{
+    st_wait_for_pending_writes(path);
+    return st_container_read_file_section(path, section, buffer);
+}
@@ -15,105 +15,150 @@
 #include <r4300/exception.h>
 #include <r4300/vcr.h>
 #include <r4300/timers.h>
+#include <r4300/tracelog.h>
+#include <r4300/perf.h>
 #include <memory/pif.h>
+#include <memory/save_media.h>
 
-typedef struct _interrupt_queue {
+typedef struct {
     int32_t type;
     uint32_t count;
-    struct _interrupt_queue* next;
-} interrupt_queue;
+} interrupt_event;
 
-static interrupt_queue* q = NULL;
+// The amount of known interrupt types, which are single bits starting at VI_INT.
+constexpr size_t INTERRUPT_TYPE_COUNT = 9;
 
-interrupt_queue g_pool[128]{};
-uint8_t g_pool_used[sizeof(g_pool)]{};
-size_t g_known_unused_index = SIZE_MAX;
+// The pending events, stored in reverse firing order: the last element is the next event to fire.
+// Keeping the head at the end makes popping it free and keeps inserts of soon-to-fire events, which are the common case, close to the end.
+static interrupt_event g_queue[128]{};
+static size_t g_queue_len = 0;
+
+// The amount of queued events of each known type.
+static uint8_t g_type_counts[INTERRUPT_TYPE_COUNT]{};
+
+// The physical index of each known type's event in the queue. Only valid if exactly one event of that type is queued.
+static uint8_t g_type_slots[INTERRUPT_TYPE_COUNT]{};
 
 /**
- * Allocates an item in the interrupt pool.
+ * Gets the index of a known interrupt type, or -1 if the type is unknown.
  */
-interrupt_queue* pool_alloc()
+static int32_t type_index(const int32_t type)
 {
-    size_t unused_index = SIZE_MAX;
-
-    // OPTIMIZATION: If we know that there is an unused index, use it
-    if (g_known_unused_index != SIZE_MAX)
+    const auto utype = static_cast<uint32_t>(type);
+    if (!std::has_single_bit(utype) || utype >= (1u << INTERRUPT_TYPE_COUNT))
     {
-        unused_index = g_known_unused_index;
+        return -1;
     }
-    else
+    return std::countr_zero(utype);
+}
+
+/**
+ * Gets the event at the specified position in firing order.
+ */
+static interrupt_event& queue_at(const size_t i)
+{
+    return g_queue[g_queue_len - 1 - i];
+}
+
+/**
+ * Updates the type slots of the events in the physical range [begin, end).
+ */
+static void queue_reindex(const size_t begin, const size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
     {
-        for (int32_t i = 0; i < sizeof(g_pool); ++i)
+        const auto index = type_index(g_queue[i].type);
+        if (index != -1)
         {
-            if (g_pool_used[i] == false)
-            {
-                unused_index = i;
-                break;
-            }
+            g_type_slots[index] = static_cast<uint8_t>(i);
         }
-        assert(unused_index != SIZE_MAX);
     }
+}
 
-    g_pool_used[unused_index] = true;
-    g_known_unused_index = SIZE_MAX;
+/**
+ * Inserts an event at the specified position in firing order.
+ */
+static void queue_insert(const size_t i, const int32_t type, const uint32_t count)
+{
+    assert(g_queue_len < std::size(g_queue));
+
+    const size_t pos = g_queue_len - i;
+    memmove(&g_queue[pos + 1], &g_queue[pos], (g_queue_len - pos) * sizeof(interrupt_event));
+    g_queue[pos] = {type, count};
+    ++g_queue_len;
 
-    return &g_pool[unused_index];
+    const auto index = type_index(type);
+    if (index != -1)
+    {
+        ++g_type_counts[index];
+    }
+    queue_reindex(pos, g_queue_len);
 }
 
 /**
- * Frees an interrupt from the pool, allowing it to be reused.
+ * Removes the event at the specified physical index.
  */
-void pool_free(const interrupt_queue* ptr)
+static void queue_erase_slot(const size_t pos)
 {
-    const auto index_in_pool = ptr - (interrupt_queue*)&g_pool;
+    const auto type = g_queue[pos].type;
+    const auto index = type_index(type);
+    if (index != -1)
+    {
+        --g_type_counts[index];
+    }
 
-#ifdef _DEBUG
-    size_t index = SIZE_MAX;
-    for (int32_t i = 0; i < sizeof(g_pool); ++i)
+    memmove(&g_queue[pos], &g_queue[pos + 1], (g_queue_len - pos - 1) * sizeof(interrupt_event));
+    --g_queue_len;
+    queue_reindex(pos, g_queue_len);
+
+    // The remaining duplicate may lie outside the reindexed range
+    if (index != -1 && g_type_counts[index] == 1)
     {
-        if (&g_pool[i] == ptr)
+        for (size_t i = 0; i < g_queue_len; ++i)
         {
-            index = i;
-            break;
+            if (g_queue[i].type == type)
+                g_type_slots[index] = static_cast<uint8_t>(i);
         }
     }
-
-    assert(index != SIZE_MAX);
-    assert(index == index_in_pool);
-#endif
-
-    g_pool_used[index_in_pool] = false;
-    g_known_unused_index = index_in_pool;
 }
 
 /**
- * Clears the pool.
+ * Finds the physical index of the first event of the specified type in firing order.
+ * \return The index, or SIZE_MAX if no event of that type is queued.
  */
-void pool_clear()
+static size_t queue_find(const int32_t type)
 {
-    memset(g_pool_used, 0, std::size(g_pool_used));
-    g_known_unused_index = SIZE_MAX;
+    const auto index = type_index(type);
+    if (index != -1)
+    {
+        if (g_type_counts[index] == 0)
+            return SIZE_MAX;
+        if (g_type_counts[index] == 1)
+            return g_type_slots[index];
+    }
+
+    for (size_t i = g_queue_len; i-- > 0;)
+    {
+        if (g_queue[i].type == type)
+            return i;
+    }
+    return SIZE_MAX;
 }
 
 void clear_queue()
 {
-    while (q != NULL)
-    {
-        interrupt_queue* aux = q->next;
-        q = aux;
-    }
-    pool_clear();
+    g_queue_len = 0;
+    memset(g_type_counts, 0, sizeof(g_type_counts));
 }
 
 void print_queue()
 {
-    interrupt_queue* aux;
     g_core->log_info(std::format(L"------------------ {:#06x}", core_Count));
-    aux = q;
-    while (aux != NULL)
+    for (size_t i = 0; i < g_queue_len; ++i)
     {
+        const auto& aux = queue_at(i);
         std::wstring type = L"";
-        switch (aux->type)
+        switch (aux.type)
         {
         case VI_INT:
             type = L"VI";
@@ -146,8 +191,7 @@ void print_queue()
             type = L"UNKNOWN";
             break;
         }
-        g_core->log_info(std::format(L"@{:#06x} {}", aux->count, type));
-        aux = aux->next;
+        g_core->log_info(std::format(L"@{:#06x} {}", aux.count, type));
     }
     g_core->log_info(L"------------------");
 }
@@ -216,61 +260,37 @@ void add_interrupt_event(int32_t type, uint32_t delay)
         g_core->log_info(std::format(L"two events of type {:#06x} in queue", type));
         print_queue();
     }
-    interrupt_queue* aux = q;
-
     // if (type == PI_INT)
     //{
     // delay = 0;
     // count = Count + delay/**2*/;
     // }
 
-    if (q == NULL)
+    if (g_queue_len == 0)
     {
-        q = pool_alloc();
-        q->next = NULL;
-        q->count = count;
-        q->type = type;
-        next_interrupt = q->count;
+        queue_insert(0, type, count);
+        next_interrupt = count;
         // print_queue();
         return;
     }
 
     // finds place in queue to insert the interrupt ( its sorted )
-    if (before_event(count, q->count, q->type) && !special)
+    if (before_event(count, queue_at(0).count, queue_at(0).type) && !special)
     {
-        q = pool_alloc();
-        q->next = aux;
-        q->count = count;
-        q->type = type;
-        next_interrupt = q->count;
+        queue_insert(0, type, count);
+        next_interrupt = count;
         // print_queue();
         return;
     }
 
-    while (aux->next != NULL && (!before_event(count, aux->next->count, aux->next->type) || special))
-        aux = aux->next;
+    size_t aux = 0;
+    while (aux + 1 < g_queue_len && (!before_event(count, queue_at(aux + 1).count, queue_at(aux + 1).type) || special))
+        aux++;
 
-    if (aux->next == NULL)
-    {
-        aux->next = pool_alloc();
-        aux = aux->next;
-        aux->next = NULL;
-        aux->count = count;
-        aux->type = type;
-    }
-    else
-    {
-        interrupt_queue* aux2;
-        if (type != SPECIAL_INT)
-            while (aux->next != NULL && aux->next->count == count)
-                aux = aux->next;
-        aux2 = aux->next;
-        aux->next = pool_alloc();
-        aux = aux->next;
-        aux->next = aux2;
-        aux->count = count;
-        aux->type = type;
-    }
+    if (aux + 1 < g_queue_len && type != SPECIAL_INT)
+        while (aux + 1 < g_queue_len && queue_at(aux + 1).count == count)
+            aux++;
+    queue_insert(aux + 1, type, count);
     /*if (q->count > Count || (Count - q->count) < 0x80000000)
       next_interrupt = q->count;
     else
@@ -291,13 +311,11 @@ void add_interrupt_event_count(int32_t type, uint32_t count)
 
 void remove_interrupt_event()
 {
-    interrupt_queue* aux = q->next;
-    if (q->type == SPECIAL_INT)
+    if (queue_at(0).type == SPECIAL_INT)
         SPECIAL_done = 1;
-    pool_free(q);
-    q = aux;
-    if (q != NULL && (q->count > core_Count || (core_Count - q->count) < 0x80000000))
-        next_interrupt = q->count;
+    queue_erase_slot(g_queue_len - 1);
+    if (g_queue_len != 0 && (queue_at(0).count > core_Count || (core_Count - queue_at(0).count) < 0x80000000))
+        next_interrupt = queue_at(0).count;
     else
         next_interrupt = 0;
 }
@@ -309,16 +327,10 @@ void remove_interrupt_event()
 /// <returns></returns>
 uint32_t get_event(int32_t type)
 {
-    interrupt_queue* aux = q;
-    if (q == NULL)
+    const size_t pos = queue_find(type);
+    if (pos == SIZE_MAX)
         return 0;
-    if (q->type == type)
-        return q->count;
-    while (aux->next != NULL && aux->next->type != type)
-        aux = aux->next;
-    if (aux->next != NULL)
-        return aux->next->count;
-    return 0;
+    return g_queue[pos].count;
 }
 
 /// <summary>
@@ -327,36 +339,18 @@ uint32_t get_event(int32_t type)
 /// <param name="type">interrupt type to find</param>
 void remove_event(int32_t type)
 {
-    interrupt_queue* aux = q;
-    if (q == NULL)
-        return;
-    if (q->type == type)
-    {
-        aux = aux->next;
-        pool_free(q);
-        q = aux;
-        return;
-    }
-    while (aux->next != NULL && aux->next->type != type)
-        aux = aux->next;
-    if (aux->next != NULL) // it's a type int32_t
-    {
-        interrupt_queue* aux2 = aux->next->next;
-        pool_free(aux->next);
-        aux->next = aux2;
-    }
+    const size_t pos = queue_find(type);
+    if (pos != SIZE_MAX)
+        queue_erase_slot(pos);
 }
 
 void translate_event_queue(uint32_t base)
 {
-    interrupt_queue* aux;
     remove_event(COMPARE_INT);
     remove_event(SPECIAL_INT);
-    aux = q;
-    while (aux != NULL)
+    for (size_t i = 0; i < g_queue_len; ++i)
     {
-        aux->count = (aux->count - core_Count) + base;
-        aux = aux->next;
+        g_queue[i].count = (g_queue[i].count - core_Count) + base;
     }
     add_interrupt_event_count(COMPARE_INT, core_Compare);
     add_interrupt_event_count(SPECIAL_INT, 0);
@@ -371,18 +365,12 @@ int32_t save_eventqueue_infos(char* buf)
         g_core->log_info(L"SI_INT not found");
 #endif
     int32_t len = 0;
-    interrupt_queue* aux = q;
-    if (q == NULL)
-    {
-        *((uint32_t*)&buf[0]) = 0xFFFFFFFF;
-        return 4;
-    }
-    while (aux != NULL)
+    for (size_t i = 0; i < g_queue_len; ++i)
     {
-        memcpy(buf + len, &aux->type, 4);
-        memcpy(buf + len + 4, &aux->count, 4);
+        const auto& aux = queue_at(i);
+        memcpy(buf + len, &aux.type, 4);
+        memcpy(buf + len + 4, &aux.count, 4);
         len += 8;
-        aux = aux->next;
     }
     *((uint32_t*)&buf[len]) = 0xFFFFFFFF;
     return len + 4;
@@ -428,21 +416,7 @@ void check_interrupt()
     // (which does nothing itself but makes cpu jump to general exception vector)
     if (core_Status & core_Cause & 0xFF00)
     {
-        if (q == NULL)
-        {
-            q = pool_alloc();
-            q->next = NULL;
-            q->count = core_Count;
-            q->type = CHECK_INT;
-        }
-        else
-        {
-            interrupt_queue* aux = pool_alloc();
-            aux->next = q;
-            aux->count = core_Count;
-            aux->type = CHECK_INT;
-            q = aux;
-        }
+        queue_insert(0, CHECK_INT, core_Count);
         next_interrupt = core_Count;
     }
 }
@@ -457,8 +431,8 @@ void gen_interrupt()
 
     if (skip_jump)
     {
-        if (q->count > core_Count || (core_Count - q->count) < 0x80000000)
-            next_interrupt = q->count;
+        if (queue_at(0).count > core_Count || (core_Count - queue_at(0).count) < 0x80000000)
+            next_interrupt = queue_at(0).count;
         else
             next_interrupt = 0;
         if (interpcore)
@@ -476,8 +450,8 @@ void gen_interrupt()
         skip_jump = 0;
         return;
     }
-    auto type = q->type;
-    switch (q->type)
+    auto type = queue_at(0).type;
+    switch (type)
     {
     case SPECIAL_INT:
         if (core_Count > 0x10000000)
@@ -497,7 +471,7 @@ void gen_interrupt()
             // The update-limiting logic doesn't apply in frameadvance because there are no high-frequency updates
             if (update || frame_advance_outstanding)
             {
-                g_core->update_screen();
+                perf_measure(core_perf_update_screen, g_core->update_screen);
                 screen_invalidated = false;
             }
 
@@ -505,6 +479,9 @@ void gen_interrupt()
 
             vcr_on_vi();
 
+            tracelog_on_vi();
+            save_media_tick();
+
             timer_new_vi();
 
             if (vi_register.vi_v_sync == 0)
@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "stdafx.h"
+#include <IOHelpers.h>
+#include <Core.h>
+#include <r4300/movie_container.h>
+#include <libdeflate.h>
+
+// Layout:
+//  t_vcr_container_header
+//  m64 header (movie_header_size bytes)
+//  chunk data, in sample order
+//  t_vcr_container_chunk[chunk_count]
+//  t_vcr_container_footer
+//
+// Chunk data is a sequence of runs, each being a LEB128 run length followed by the repeated 32-bit sample.
+// Every chunk except the last one holds exactly VCR_CONTAINER_CHUNK_SAMPLES samples, so appending only rewrites the last chunk, the index and the footer.
+// Incremental writes append those after the previous footer instead of overwriting it, so a file can hold several generations of index and footer.
+// The reader uses the newest one whose index and chunks verify.
+
+constexpr char VCR_CONTAINER_MAGIC[4] = {'M', '6', '4', 'Z'};
+constexpr char VCR_CONTAINER_FOOTER_MAGIC[4] = {'M', '6', '4', 'I'};
+
+constexpr int VCR_CONTAINER_COMPRESSION_LEVEL = 6;
+
+// The amount of superseded data an incrementally written file can accumulate before it's compacted, regardless of its live size.
+constexpr uint64_t VCR_CONTAINER_COMPACT_THRESHOLD = 1024 * 1024;
+
+typedef struct {
+    std::filesystem::path path;
+    uint32_t movie_header_size;
+    // The full chunks which are known to be on disk, in sample order.
+    std::vector<t_vcr_container_chunk> chunks;
+} t_vcr_container_state;
+
+// The state of the last incremental write.
+static t_vcr_container_state g_incremental{};
+
+static uint64_t hash_samples(std::span<const core_buttons> samples)
+{
+    return xxh64::hash((const char*)samples.data(), samples.size() * sizeof(core_buttons), 0);
+}
+
+static void encode_runs(std::span<const core_buttons> samples, std::vector<uint8_t>& out)
+{
+    out.clear();
+
+    size_t i = 0;
+    while (i < samples.size())
+    {
+        const uint32_t value = samples[i].value;
+        size_t run = 1;
+        while (i + run < samples.size() && samples[i + run].value == value)
+        {
+            ++run;
+        }
+
+        for (size_t n = run; ; n >>= 7)
+        {
+            if (n < 0x80)
+            {
+                out.push_back((uint8_t)n);
+                break;
+            }
+            out.push_back((uint8_t)(n & 0x7F) | 0x80);
+        }
+
+        const auto bytes = (const uint8_t*)&value;
+        out.insert(out.end(), bytes, bytes + sizeof(value));
+
+        i += run;
+    }
+}
+
+static bool decode_runs(std::span<const uint8_t> data, const size_t sample_count, core_buttons* out)
+{
+    size_t pos = 0;
+    size_t written = 0;
+
+    while (pos < data.size())
+    {
+        uint64_t run = 0;
+        for (uint32_t shift = 0;; shift += 7)
+        {
+            if (pos >= data.size() || shift > 28)
+            {
+                return false;
+            }
+            const uint8_t byte = data[pos++];
+            run |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                break;
+            }
+        }
+
+        if (pos + sizeof(uint32_t) > data.size() || run == 0 || written + run > sample_count)
+        {
+            return false;
+        }
+
+        core_buttons value{};
+        memcpy(&value.value, data.data() + pos, sizeof(uint32_t));
+        pos += sizeof(uint32_t);
+
+        std::fill_n(out + written, run, value);
+        written += run;
+    }
+
+    return written == sample_count;
+}
+
+static bool write_chunk(std::fstream& f, std::span<const core_buttons> samples, const uint32_t first_sample, const uint64_t offset, t_vcr_container_chunk& chunk)
+{
+    thread_local std::unique_ptr<libdeflate_compressor, decltype(&libdeflate_free_compressor)> compressor(libdeflate_alloc_compressor(VCR_CONTAINER_COMPRESSION_LEVEL), &libdeflate_free_compressor);
+    thread_local std::vector<uint8_t> runs;
+    thread_local std::vector<uint8_t> compressed;
+
+    encode_runs(samples, runs);
+
+    chunk = {};
+    chunk.offset = offset;
+    chunk.first_sample = first_sample;
+    chunk.sample_count = (uint32_t)samples.size();
+    chunk.hash = hash_samples(samples);
+
+    compressed.resize(libdeflate_deflate_compress_bound(compressor.get(), runs.size()));
+    const size_t compressed_size = libdeflate_deflate_compress(compressor.get(), runs.data(), runs.size(), compressed.data(), compressed.size());
+
+    // Highly repetitive chunks often end up larger when deflated, so keep whichever representation is smaller
+    if (compressed_size != 0 && compressed_size < runs.size())
+    {
+        chunk.encoding = vcr_chunk_encoding_rle_deflate;
+        chunk.stored_size = (uint32_t)compressed_size;
+        f.write((const char*)compressed.data(), compressed_size);
+    }
+    else
+    {
+        chunk.encoding = vcr_chunk_encoding_rle;
+        chunk.stored_size = (uint32_t)runs.size();
+        f.write((const char*)runs.data(), runs.size());
+    }
+
+    return f.good();
+}
+
+bool vcr_container_is_container_path(const std::filesystem::path& path)
+{
+    return path.extension() == ".m64z";
+}
+
+bool vcr_container_write(const std::filesystem::path& path, std::span<const uint8_t> movie_header, std::span<const core_buttons> samples, std::span<const uint8_t> tail, const bool incremental)
+{
+    if (tail.size() >= sizeof(core_buttons) || samples.size() > UINT32_MAX)
+    {
+        return false;
+    }
+
+    t_vcr_container_state local{};
+    auto& state = incremental ? g_incremental : local;
+
+    std::error_code ec;
+    const uint64_t file_size = std::filesystem::file_size(path, ec);
+    bool reuse = !ec && incremental && state.path == path && state.movie_header_size == movie_header.size();
+    if (!reuse)
+    {
+        state = {path, (uint32_t)movie_header.size(), {}};
+    }
+
+    // Keep the leading full chunks whose samples are unchanged, everything after the first difference is rewritten
+    size_t kept = 0;
+    for (; kept < state.chunks.size(); ++kept)
+    {
+        const auto& chunk = state.chunks[kept];
+        if (chunk.first_sample + chunk.sample_count > samples.size() || hash_samples(samples.subspan(chunk.first_sample, chunk.sample_count)) != chunk.hash)
+        {
+            break;
+        }
+    }
+    state.chunks.resize(kept);
+
+    const uint64_t data_start = sizeof(t_vcr_container_header) + movie_header.size();
+    const uint64_t kept_end = state.chunks.empty() ? data_start : state.chunks.back().offset + state.chunks.back().stored_size;
+
+    // Superseded tails pile up after the kept chunks, so compact the file once they outweigh the live data
+    if (reuse && (file_size < kept_end || file_size - kept_end > std::max<uint64_t>(kept_end, VCR_CONTAINER_COMPACT_THRESHOLD)))
+    {
+        reuse = false;
+        state.chunks.clear();
+        kept = 0;
+    }
+
+    // Incremental writes append the new tail after the previous footer, so an interrupted write leaves the previous footer intact.
+    // Full writes go through a temporary file, so the existing movie is only replaced once the new one is complete.
+    auto write_path = path;
+    if (!reuse)
+    {
+        write_path += L".tmp";
+    }
+
+    const auto fail = [&] {
+        state = {};
+        if (!reuse)
+        {
+            std::error_code remove_ec;
+            std::filesystem::remove(write_path, remove_ec);
+        }
+        return false;
+    };
+
+    std::fstream f(write_path, reuse ? std::ios::in | std::ios::out | std::ios::binary : std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!f)
+    {
+        return fail();
+    }
+
+    t_vcr_container_header header{};
+    memcpy(header.magic, VCR_CONTAINER_MAGIC, sizeof(header.magic));
+    header.version = VCR_CONTAINER_VERSION;
+    header.movie_header_size = (uint32_t)movie_header.size();
+
+    uint64_t offset = reuse ? file_size : data_start;
+
+    if (!reuse)
+    {
+        f.write((const char*)&header, sizeof(header));
+        f.write((const char*)movie_header.data(), movie_header.size());
+    }
+
+    f.seekp((std::streamoff)offset);
+
+    std::vector<t_vcr_container_chunk> index = state.chunks;
+    for (size_t first = kept * VCR_CONTAINER_CHUNK_SAMPLES; first < samples.size(); first += VCR_CONTAINER_CHUNK_SAMPLES)
+    {
+        const auto count = std::min<size_t>(VCR_CONTAINER_CHUNK_SAMPLES, samples.size() - first);
+
+        t_vcr_container_chunk chunk{};
+        if (!write_chunk(f, samples.subspan(first, count), (uint32_t)first, offset, chunk))
+        {
+            return fail();
+        }
+
+        index.push_back(chunk);
+        offset += chunk.stored_size;
+
+        // The trailing partial chunk is rewritten by every write, so it's not tracked
+        if (count == VCR_CONTAINER_CHUNK_SAMPLES)
+        {
+            state.chunks.push_back(chunk);
+        }
+    }
+
+    t_vcr_container_footer footer{};
+    footer.index_offset = offset;
+    footer.chunk_count = (uint32_t)index.size();
+    footer.sample_count = (uint32_t)samples.size();
+    footer.tail_size = (uint8_t)tail.size();
+    memcpy(footer.tail, tail.data(), tail.size());
+    memcpy(footer.magic, VCR_CONTAINER_FOOTER_MAGIC, sizeof(footer.magic));
+
+    f.write((const char*)index.data(), index.size() * sizeof(t_vcr_container_chunk));
+    f.write((const char*)&footer, sizeof(footer));
+
+    if (reuse)
+    {
+        // The m64 header is patched last, since the reader tolerates a header which disagrees with the sample count
+        f.flush();
+        f.seekp((std::streamoff)sizeof(header));
+        f.write((const char*)movie_header.data(), movie_header.size());
+    }
+
+    f.close();
+
+    if (f.fail())
+    {
+        return fail();
+    }
+
+    if (!reuse)
+    {
+        std::filesystem::rename(write_path, path, ec);
+        if (ec)
+        {
+            return fail();
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \brief Gets whether a footer is well-formed and its index ends right where the footer starts.
+ */
+static bool footer_is_consistent(const t_vcr_container_footer& footer, const uint64_t data_start, const uint64_t footer_offset)
+{
+    return !memcmp(footer.magic, VCR_CONTAINER_FOOTER_MAGIC, sizeof(footer.magic)) && footer.tail_size < sizeof(core_buttons) && footer.index_offset >= data_start && footer.index_offset <= footer_offset && footer.index_offset + (uint64_t)footer.chunk_count * sizeof(t_vcr_container_chunk) == footer_offset;
+}
+
+/**
+ * \brief Reads a compressed movie's header and the footer at the end of the file, without touching the chunks.
+ * \return Whether the file's header is valid and its last footer is consistent.
+ */
+static bool read_last_footer(const std::filesystem::path& path, std::vector<uint8_t>& movie_header, t_vcr_container_footer& footer)
+{
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f)
+    {
+        return false;
+    }
+
+    const uint64_t file_size = (uint64_t)f.tellg();
+    f.seekg(0);
+
+    t_vcr_container_header header{};
+    if (file_size < sizeof(header) + sizeof(footer) || !f.read((char*)&header, sizeof(header)))
+    {
+        return false;
+    }
+
+    if (memcmp(header.magic, VCR_CONTAINER_MAGIC, sizeof(header.magic)) || header.version != VCR_CONTAINER_VERSION || header.movie_header_size > sizeof(core_vcr_movie_header))
+    {
+        return false;
+    }
+
+    const uint64_t data_start = sizeof(header) + header.movie_header_size;
+    if (file_size < data_start + sizeof(footer))
+    {
+        return false;
+    }
+
+    movie_header.resize(header.movie_header_size);
+    if (!f.read((char*)movie_header.data(), movie_header.size()))
+    {
+        return false;
+    }
+
+    const uint64_t footer_offset = file_size - sizeof(footer);
+    f.seekg((std::streamoff)footer_offset);
+    return f.read((char*)&footer, sizeof(footer)) && footer_is_consistent(footer, data_start, footer_offset);
+}
+
+/**
+ * \brief Reads and verifies the samples referenced by a footer.
+ * \param buf The file's contents.
+ * \param data_start The offset at which chunk data starts.
+ * \param footer_offset The offset of the footer.
+ * \param samples The samples to fill.
+ * \return Whether the index and all its chunks are intact.
+ */
+static bool read_chunks(std::span<const uint8_t> buf, const uint64_t data_start, const uint64_t footer_offset, std::vector<core_buttons>& samples)
+{
+    t_vcr_container_footer footer{};
+    memcpy(&footer, buf.data() + footer_offset, sizeof(footer));
+
+    if (!footer_is_consistent(footer, data_start, footer_offset))
+    {
+        return false;
+    }
+
+    std::vector<t_vcr_container_chunk> index(footer.chunk_count);
+    memcpy(index.data(), buf.data() + footer.index_offset, index.size() * sizeof(t_vcr_container_chunk));
+
+    thread_local std::unique_ptr<libdeflate_decompressor, decltype(&libdeflate_free_decompressor)> decompressor(libdeflate_alloc_decompressor(), &libdeflate_free_decompressor);
+    thread_local std::vector<uint8_t> runs;
+
+    samples.resize(footer.sample_count);
+
+    size_t next_sample = 0;
+
+    for (const auto& chunk : index)
+    {
+        if (chunk.first_sample != next_sample || (uint64_t)chunk.first_sample + chunk.sample_count > footer.sample_count || chunk.offset < data_start || chunk.offset > footer.index_offset || chunk.offset + chunk.stored_size > footer.index_offset)
+        {
+            return false;
+        }
+
+        const auto stored = buf.subspan(chunk.offset, chunk.stored_size);
+
+        std::span<const uint8_t> data = stored;
+        if (chunk.encoding == vcr_chunk_encoding_rle_deflate)
+        {
+            // A run takes at least 5 bytes, so this bounds the decompressed size
+            runs.resize((size_t)chunk.sample_count * (sizeof(uint32_t) + 1));
+            size_t actual = 0;
+            if (libdeflate_deflate_decompress(decompressor.get(), stored.data(), stored.size(), runs.data(), runs.size(), &actual) != LIBDEFLATE_SUCCESS)
+            {
+                return false;
+            }
+            data = std::span<const uint8_t>(runs.data(), actual);
+        }
+        else if (chunk.encoding != vcr_chunk_encoding_rle)
+        {
+            return false;
+        }
+
+        if (!decode_runs(data, chunk.sample_count, samples.data() + chunk.first_sample))
+        {
+            return false;
+        }
+
+        if (hash_samples(std::span<const core_buttons>(samples.data() + chunk.first_sample, chunk.sample_count)) != chunk.hash)
+        {
+            return false;
+        }
+
+        next_sample += chunk.sample_count;
+    }
+
+    return next_sample == footer.sample_count;
+}
+
+core_result vcr_container_read(const std::filesystem::path& path, std::vector<uint8_t>& movie_header, std::vector<core_buttons>* samples, size_t& sample_count, std::vector<uint8_t>* tail)
+{
+    // Only the header and footer are read when the samples aren't needed. The torn tail scan below only runs if the last footer is damaged.
+    if (!samples)
+    {
+        t_vcr_container_footer footer{};
+        if (read_last_footer(path, movie_header, footer))
+        {
+            sample_count = footer.sample_count;
+
+            if (tail)
+            {
+                tail->assign(footer.tail, footer.tail + footer.tail_size);
+            }
+
+            return Res_Ok;
+        }
+    }
+
+    const auto buf = read_file_buffer(path);
+    if (buf.empty())
+    {
+        return VCR_BadFile;
+    }
+
+    t_vcr_container_header header{};
+    if (buf.size() < sizeof(header) + sizeof(t_vcr_container_footer))
+    {
+        return VCR_InvalidFormat;
+    }
+    memcpy(&header, buf.data(), sizeof(header));
+
+    if (memcmp(header.magic, VCR_CONTAINER_MAGIC, sizeof(header.magic)) || header.version != VCR_CONTAINER_VERSION || header.movie_header_size > sizeof(core_vcr_movie_header))
+    {
+        return VCR_InvalidFormat;
+    }
+
+    const uint64_t data_start = sizeof(header) + header.movie_header_size;
+    if (buf.size() < data_start + sizeof(t_vcr_container_footer))
+    {
+        return VCR_InvalidFormat;
+    }
+
+    movie_header.assign(buf.data() + sizeof(header), buf.data() + data_start);
+
+    // The newest intact footer wins. Normally that's the one at the end of the file, but an interrupted incremental write can leave a torn tail after it.
+    std::vector<core_buttons> local_samples;
+    auto& out = samples ? *samples : local_samples;
+
+    for (uint64_t footer_offset = buf.size() - sizeof(t_vcr_container_footer);; --footer_offset)
+    {
+        t_vcr_container_footer footer{};
+        memcpy(&footer, buf.data() + footer_offset, sizeof(footer));
+
+        if (read_chunks(buf, data_start, footer_offset, out))
+        {
+            if (footer_offset + sizeof(footer) != buf.size())
+            {
+                g_core->log_warn(std::format(L"[VCR] Recovered {} from a torn tail, dropping {} trailing bytes", path.wstring(), buf.size() - footer_offset - sizeof(footer)));
+            }
+
+            sample_count = footer.sample_count;
+
+            if (tail)
+            {
+                tail->assign(footer.tail, footer.tail + footer.tail_size);
+            }
+
+            return Res_Ok;
+        }
+
+        if (footer_offset == data_start)
+        {
+            break;
+        }
+    }
+
+    return VCR_InvalidFormat;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <include/core_api.h>
+
+/**
+ * The current version of the compressed movie container format.
+ */
+constexpr uint32_t VCR_CONTAINER_VERSION = 1;
+
+/**
+ * The amount of samples stored in a full chunk.
+ */
+constexpr uint32_t VCR_CONTAINER_CHUNK_SAMPLES = 0x1000;
+
+enum {
+    // The chunk's samples are run-length encoded.
+    vcr_chunk_encoding_rle,
+    // The chunk's samples are run-length encoded, then stored as a raw deflate stream.
+    vcr_chunk_encoding_rle_deflate,
+};
+
+#pragma pack(push, 1)
+/**
+ * The header of a compressed movie. Followed by <c>movie_header_size</c> bytes of the movie's m64 header.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    // The size of the m64 header stored after this header. Usually sizeof(core_vcr_movie_header), but can be shorter for truncated movies.
+    uint32_t movie_header_size;
+    uint32_t reserved;
+} t_vcr_container_header;
+
+/**
+ * An entry in the chunk index of a compressed movie.
+ */
+typedef struct {
+    // The offset of the chunk's stored data, relative to the start of the file.
+    uint64_t offset;
+    // The index of the chunk's first sample.
+    uint32_t first_sample;
+    // The amount of samples in the chunk.
+    uint32_t sample_count;
+    // The size of the chunk's stored data.
+    uint32_t stored_size;
+    // How the chunk's data is stored.
+    uint32_t encoding;
+    // The XXH64 hash of the chunk's samples.
+    uint64_t hash;
+} t_vcr_container_chunk;
+
+/**
+ * The footer at the end of a compressed movie.
+ */
+typedef struct {
+    // The offset of the chunk index, relative to the start of the file.
+    uint64_t index_offset;
+    uint32_t chunk_count;
+    uint32_t sample_count;
+    // Trailing bytes of the original m64 which don't form a whole sample, kept so conversion is lossless.
+    uint8_t tail_size;
+    uint8_t tail[3];
+    char magic[4];
+} t_vcr_container_footer;
+#pragma pack(pop)
+
+/**
+ * The offset of the m64 header within a compressed movie.
+ */
+constexpr size_t VCR_CONTAINER_MOVIE_HEADER_OFFSET = sizeof(t_vcr_container_header);
+
+/**
+ * \brief Gets whether a path refers to a compressed movie.
+ */
+bool vcr_container_is_container_path(const std::filesystem::path& path);
+
+/**
+ * \brief Writes a compressed movie.
+ * \param path The movie's path.
+ * \param movie_header The m64 header.
+ * \param samples The samples.
+ * \param tail Trailing bytes which don't form a whole sample. Must be shorter than a sample.
+ * \param incremental Whether chunks written by the previous incremental write to the same path can be kept if their samples didn't change.
+ * \return Whether the operation succeeded.
+ * \remarks Only one path is tracked for incremental writes. Writing another path incrementally discards the previous path's state.
+ */
+bool vcr_container_write(const std::filesystem::path& path, std::span<const uint8_t> movie_header, std::span<const core_buttons> samples, std::span<const uint8_t> tail, bool incremental);
+
+/**
+ * \brief Reads a compressed movie.
+ * \param path The movie's path.
+ * \param movie_header The m64 header.
+ * \param samples The samples, or nullptr to only read the header.
+ * \param sample_count The amount of samples stored in the movie.
+ * \param tail The trailing bytes which don't form a whole sample, or nullptr if not needed.
+ * \return The operation result.
+ */
+core_result vcr_container_read(const std::filesystem::path& path, std::vector<uint8_t>& movie_header, std::vector<core_buttons>* samples, size_t& sample_count, std::vector<uint8_t>* tail = nullptr);
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "stdafx.h"
+#include <include/core_api.h>
+#include <r4300/perf.h>
+
+// Samples are bucketed in nanoseconds with 2^PERF_SUB_BITS linear sub-buckets per power of two, similar to an HDR histogram.
+#define PERF_SUB_BITS 5
+#define PERF_SUB_COUNT (1 << PERF_SUB_BITS)
+#define PERF_MAX_EXPONENT 40
+#define PERF_BUCKET_COUNT ((PERF_MAX_EXPONENT - PERF_SUB_BITS + 2) * PERF_SUB_COUNT)
+
+typedef struct {
+    std::atomic<uint32_t> buckets[PERF_BUCKET_COUNT];
+    std::atomic<uint64_t> max;
+} t_perf_histogram;
+
+static t_perf_histogram histograms[core_perf_metric_count];
+
+static size_t bucket_index(uint64_t value)
+{
+    value = std::min<uint64_t>(value, (1ULL << (PERF_MAX_EXPONENT + 1)) - 1);
+
+    if (value < PERF_SUB_COUNT)
+    {
+        return (size_t)value;
+    }
+
+    const auto exponent = (size_t)std::bit_width(value) - 1;
+    const auto sub = (size_t)(value >> (exponent - PERF_SUB_BITS)) & (PERF_SUB_COUNT - 1);
+    return (exponent - PERF_SUB_BITS + 1) * PERF_SUB_COUNT + sub;
+}
+
+static uint64_t bucket_value(const size_t index)
+{
+    if (index < PERF_SUB_COUNT)
+    {
+        return index;
+    }
+
+    const auto shift = index / PERF_SUB_COUNT - 1;
+    const auto sub = index % PERF_SUB_COUNT;
+    const auto low = (uint64_t)(PERF_SUB_COUNT + sub) << shift;
+
+    // Report the bucket's midpoint to halve the worst-case error
+    return low + ((1ULL << shift) >> 1);
+}
+
+static void reset_histogram(t_perf_histogram& histogram)
+{
+    for (auto& bucket : histogram.buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    histogram.max.store(0, std::memory_order_relaxed);
+}
+
+void perf_record(const core_perf_metric metric, const std::chrono::nanoseconds duration)
+{
+    auto& histogram = histograms[metric];
+    const auto value = (uint64_t)std::max<int64_t>(duration.count(), 0);
+
+    histogram.buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+
+    // There's only one writer, so a plain compare and store is enough here
+    if (value > histogram.max.load(std::memory_order_relaxed))
+    {
+        histogram.max.store(value, std::memory_order_relaxed);
+    }
+}
+
+core_perf_summary core_perf_get_summary(const core_perf_metric metric)
+{
+    if (metric >= core_perf_metric_count)
+    {
+        return {};
+    }
+
+    const auto& histogram = histograms[metric];
+
+    // Snapshot the buckets first so the percentiles are computed over a consistent sample count
+    std::vector<uint32_t> buckets(PERF_BUCKET_COUNT);
+    uint64_t count = 0;
+    for (size_t i = 0; i < PERF_BUCKET_COUNT; ++i)
+    {
+        buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+        count += buckets[i];
+    }
+
+    core_perf_summary summary{};
+    summary.count = count;
+    summary.max = (double)histogram.max.load(std::memory_order_relaxed) / 1000000.0;
+
+    if (count == 0)
+    {
+        return summary;
+    }
+
+    const auto percentile = [&](const double p) {
+        const auto rank = std::max<uint64_t>(1, (uint64_t)std::ceil(p * (double)count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < PERF_BUCKET_COUNT; ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+            {
+                return std::min((double)bucket_value(i) / 1000000.0, summary.max);
+            }
+        }
+        return summary.max;
+    };
+
+    summary.p50 = percentile(0.5);
+    summary.p99 = percentile(0.99);
+    summary.p999 = percentile(0.999);
+
+    return summary;
+}
+
+void core_perf_reset(const core_perf_metric metric)
+{
+    if (metric == core_perf_metric_count)
+    {
+        for (auto& histogram : histograms)
+        {
+            reset_histogram(histogram);
+        }
+        return;
+    }
+
+    if (metric < core_perf_metric_count)
+    {
+        reset_histogram(histograms[metric]);
+    }
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2025, Mupen64 maintainers, contributors, and original authors (Hacktarux, ShadowPrince, linker).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+/**
+ * \brief Records a sample into a performance histogram.
+ * \param metric The metric to record the sample for.
+ * \param duration The sample.
+ * \remarks Lock-free. Must only be called from the emu thread.
+ */
+void perf_record(core_perf_metric metric, std::chrono::nanoseconds duration);
+
+/**
+ * \brief Invokes a function and records its execution time into a performance histogram.
+ * \param metric The metric to record the execution time for.
+ * \param func The function to invoke.
+ */
+template <typename F>
+void perf_measure(const core_perf_metric metric, F&& func)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    func();
+    perf_record(metric, std::chrono::high_resolution_clock::now() - start);
+}
@@ -22,6 +22,21 @@ uint32_t interp_addr;
 uint32_t vr_op;
 static int32_t skip;
 
+/**
+ * The decoded instructions of a physical page. Each entry holds the resolved handler in ops and the instruction word it was decoded from in src.
+ */
+struct t_decoded_page {
+    // One extra entry, as the decoder peeks at the next instruction
+    precomp_instr instrs[0x401];
+    const uint32_t* memory;
+};
+
+// Decoded pages, keyed by physical page. Allocated on first fetch.
+static std::unique_ptr<t_decoded_page> g_decoded_pages[0x20000];
+
+// The decoded page each virtual page maps to. Only valid while the page's invalid_code flag is cleared.
+static t_decoded_page* g_decoded_vpages[0x100000];
+
 void prefetch();
 
 extern void (*interp_ops[])(void);
@@ -82,7 +97,7 @@ static void JR()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     interp_addr = local_rs32;
@@ -98,7 +113,7 @@ static void JALR()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if (!skip_jump)
@@ -484,7 +499,7 @@ static void BLTZ()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if (local_rs < 0)
@@ -515,7 +530,7 @@ static void BGEZ()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if (local_rs >= 0)
@@ -548,7 +563,7 @@ static void BLTZL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         interp_addr += (local_immediate - 1) * 4;
@@ -583,7 +598,7 @@ static void BGEZL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         interp_addr += (local_immediate - 1) * 4;
@@ -619,7 +634,7 @@ static void BLTZAL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         if (local_rs < 0)
@@ -656,7 +671,7 @@ static void BGEZAL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         if (local_rs >= 0)
@@ -695,7 +710,7 @@ static void BLTZALL()
             interp_addr += 4;
             delay_slot = 1;
             prefetch();
-            interp_ops[((vr_op >> 26) & 0x3F)]();
+            PC->ops();
             update_count();
             delay_slot = 0;
             interp_addr += (local_immediate - 1) * 4;
@@ -736,7 +751,7 @@ static void BGEZALL()
             interp_addr += 4;
             delay_slot = 1;
             prefetch();
-            interp_ops[((vr_op >> 26) & 0x3F)]();
+            PC->ops();
             update_count();
             delay_slot = 0;
             interp_addr += (local_immediate - 1) * 4;
@@ -773,7 +788,10 @@ static void TLBWI()
     if (tlb_e[core_Index & 0x3F].v_even)
     {
         for (i = tlb_e[core_Index & 0x3F].start_even; i < tlb_e[core_Index & 0x3F].end_even; i++)
+        {
             tlb_LUT_r[i >> 12] = 0;
+            invalid_code[i >> 12] = 1;
+        }
         if (tlb_e[core_Index & 0x3F].d_even)
             for (i = tlb_e[core_Index & 0x3F].start_even; i < tlb_e[core_Index & 0x3F].end_even; i++)
                 tlb_LUT_w[i >> 12] = 0;
@@ -781,7 +799,10 @@ static void TLBWI()
     if (tlb_e[core_Index & 0x3F].v_odd)
     {
         for (i = tlb_e[core_Index & 0x3F].start_odd; i < tlb_e[core_Index & 0x3F].end_odd; i++)
+        {
             tlb_LUT_r[i >> 12] = 0;
+            invalid_code[i >> 12] = 1;
+        }
         if (tlb_e[core_Index & 0x3F].d_odd)
             for (i = tlb_e[core_Index & 0x3F].start_odd; i < tlb_e[core_Index & 0x3F].end_odd; i++)
                 tlb_LUT_w[i >> 12] = 0;
@@ -813,8 +834,11 @@ static void TLBWI()
             tlb_e[core_Index & 0x3F].phys_even < 0x20000000)
         {
             for (i = tlb_e[core_Index & 0x3F].start_even; i < tlb_e[core_Index & 0x3F].end_even; i++)
+            {
                 tlb_LUT_r[i >> 12] = 0x80000000 |
                 (tlb_e[core_Index & 0x3F].phys_even + (i - tlb_e[core_Index & 0x3F].start_even));
+                invalid_code[i >> 12] = 1;
+            }
             if (tlb_e[core_Index & 0x3F].d_even)
                 for (i = tlb_e[core_Index & 0x3F].start_even; i < tlb_e[core_Index & 0x3F].end_even; i++)
                     tlb_LUT_w[i >> 12] = 0x80000000 |
@@ -835,8 +859,11 @@ static void TLBWI()
             tlb_e[core_Index & 0x3F].phys_odd < 0x20000000)
         {
             for (i = tlb_e[core_Index & 0x3F].start_odd; i < tlb_e[core_Index & 0x3F].end_odd; i++)
+            {
                 tlb_LUT_r[i >> 12] = 0x80000000 |
                 (tlb_e[core_Index & 0x3F].phys_odd + (i - tlb_e[core_Index & 0x3F].start_odd));
+                invalid_code[i >> 12] = 1;
+            }
             if (tlb_e[core_Index & 0x3F].d_odd)
                 for (i = tlb_e[core_Index & 0x3F].start_odd; i < tlb_e[core_Index & 0x3F].end_odd; i++)
                     tlb_LUT_w[i >> 12] = 0x80000000 |
@@ -854,7 +881,10 @@ static void TLBWR()
     if (tlb_e[core_Random].v_even)
     {
         for (i = tlb_e[core_Random].start_even; i < tlb_e[core_Random].end_even; i++)
+        {
             tlb_LUT_r[i >> 12] = 0;
+            invalid_code[i >> 12] = 1;
+        }
         if (tlb_e[core_Random].d_even)
             for (i = tlb_e[core_Random].start_even; i < tlb_e[core_Random].end_even; i++)
                 tlb_LUT_w[i >> 12] = 0;
@@ -862,7 +892,10 @@ static void TLBWR()
     if (tlb_e[core_Random].v_odd)
     {
         for (i = tlb_e[core_Random].start_odd; i < tlb_e[core_Random].end_odd; i++)
+        {
             tlb_LUT_r[i >> 12] = 0;
+            invalid_code[i >> 12] = 1;
+        }
         if (tlb_e[core_Random].d_odd)
             for (i = tlb_e[core_Random].start_odd; i < tlb_e[core_Random].end_odd; i++)
                 tlb_LUT_w[i >> 12] = 0;
@@ -894,8 +927,11 @@ static void TLBWR()
             tlb_e[core_Random].phys_even < 0x20000000)
         {
             for (i = tlb_e[core_Random].start_even; i < tlb_e[core_Random].end_even; i++)
+            {
                 tlb_LUT_r[i >> 12] = 0x80000000 |
                 (tlb_e[core_Random].phys_even + (i - tlb_e[core_Random].start_even));
+                invalid_code[i >> 12] = 1;
+            }
             if (tlb_e[core_Random].d_even)
                 for (i = tlb_e[core_Random].start_even; i < tlb_e[core_Random].end_even; i++)
                     tlb_LUT_w[i >> 12] = 0x80000000 |
@@ -915,8 +951,11 @@ static void TLBWR()
             tlb_e[core_Random].phys_odd < 0x20000000)
         {
             for (i = tlb_e[core_Random].start_odd; i < tlb_e[core_Random].end_odd; i++)
+            {
                 tlb_LUT_r[i >> 12] = 0x80000000 |
                 (tlb_e[core_Random].phys_odd + (i - tlb_e[core_Random].start_odd));
+                invalid_code[i >> 12] = 1;
+            }
             if (tlb_e[core_Random].d_odd)
                 for (i = tlb_e[core_Random].start_odd; i < tlb_e[core_Random].end_odd; i++)
                     tlb_LUT_w[i >> 12] = 0x80000000 |
@@ -1142,7 +1181,7 @@ static void BC1F()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if ((FCR31 & 0x800000) == 0)
@@ -1172,7 +1211,7 @@ static void BC1T()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if ((FCR31 & 0x800000) != 0)
@@ -1204,7 +1243,7 @@ static void BC1FL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         interp_addr += (local_immediate - 1) * 4;
@@ -1238,7 +1277,7 @@ static void BC1TL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         interp_addr += (local_immediate - 1) * 4;
@@ -2186,7 +2225,7 @@ static void J()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     interp_addr = naddr;
@@ -2205,7 +2244,7 @@ static void JAL()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if (!skip_jump)
@@ -2232,7 +2271,7 @@ static void BEQ()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if (local_rs == local_rt && !g_vr_beq_ignore_jmp)
@@ -2254,7 +2293,7 @@ static void BNE()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if (local_rs != local_rt)
@@ -2275,7 +2314,7 @@ static void BLEZ()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if (local_rs <= 0)
@@ -2296,7 +2335,7 @@ static void BGTZ()
     interp_addr += 4;
     delay_slot = 1;
     prefetch();
-    interp_ops[((vr_op >> 26) & 0x3F)]();
+    PC->ops();
     update_count();
     delay_slot = 0;
     if (local_rs > 0)
@@ -2401,7 +2440,7 @@ static void BEQL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         interp_addr += (local_immediate - 1) * 4;
@@ -2440,7 +2479,7 @@ static void BNEL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         interp_addr += (local_immediate - 1) * 4;
@@ -2478,7 +2517,7 @@ static void BLEZL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         interp_addr += (local_immediate - 1) * 4;
@@ -2516,7 +2555,7 @@ static void BGTZL()
         interp_addr += 4;
         delay_slot = 1;
         prefetch();
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         update_count();
         delay_slot = 0;
         interp_addr += (local_immediate - 1) * 4;
@@ -3083,74 +3122,110 @@ void (*interp_ops[64])(void) =
 {
 SPECIAL, REGIMM, J, JAL, BEQ, BNE, BLEZ, BGTZ, ADDI, ADDIU, SLTI, SLTIU, ANDI, ORI, XORI, LUI, COP0, COP1, NI, NI, BEQL, BNEL, BLEZL, BGTZL, DADDI, DADDIU, LDL, LDR, NI, NI, NI, NI, LB, LH, LWL, LW, LBU, LHU, LWR, LWU, SB, SH, SWL, SW, SDL, SDR, SWR, CACHE, LL, LWC1, NI, NI, NI, LDC1, NI, LD, SC, SWC1, NI, NI, NI, SDC1, NI, SD};
 
-// Get opcode from address (interp_address)
-void prefetch()
+/**
+ * Resolves the handler an instruction word ends up in, skipping the intermediate dispatch tables.
+ */
+static void (*resolve_handler(uint32_t op))(void)
 {
-    // static FILE *f = NULL;
-    // static int32_t line=1;
-    // static int32_t tlb_used = 0;
-    // uint32_t comp;
-    // if (!tlb_used)
-    //{
-    /*if (f==NULL) f = fopen("/mnt/windows/pcdeb.txt", "rb");
-    fscanf(f, "%x", &comp);
-    if (comp != interp_addr)
-      {
-         g_core->log_info(L"diff@%x, line:{}", interp_addr, line);
-         stop=1;
-      }*/
-    // line++;
-    // if ((debug_count+Count) > 0x50fe000) g_core->log_info(L"line:{}", line);
-    /*if ((debug_count+Count) > 0xb70000)
-      g_core->log_info(L"count:%x, add:%x, op:%x, l{}\n", (int32_t)(Count+debug_count),
-         interp_addr, op, line);*/
-    //}
-    // g_core->log_info(L"addr:%x", interp_addr);
-    if ((interp_addr >= 0x80000000) && (interp_addr < 0xc0000000))
-    {
-        if (/*(interp_addr >= 0x80000000) && */ (interp_addr < 0x80800000))
-        {
-            vr_op = *(uint32_t*)&((unsigned char*)rdram)[(interp_addr & 0xFFFFFF)];
-            /*if ((debug_count+Count) > 0xabaa20)
-              g_core->log_info(L"count:%x, add:%x, op:%x, l{}\n", (int32_t)(Count+debug_count),
-                 interp_addr, op, line);*/
-            prefetch_opcode(vr_op);
-        }
-        else if ((interp_addr >= 0xa4000000) && (interp_addr < 0xa4001000))
-        {
-            vr_op = SP_DMEM[(interp_addr & 0xFFF) / 4];
-            prefetch_opcode(vr_op);
-        }
-        else if ((interp_addr > 0xb0000000))
-        {
-            vr_op = ((uint32_t*)rom)[(interp_addr & 0xFFFFFFF) / 4];
-            prefetch_opcode(vr_op);
-        }
-        else
-        {
-            // unmapped memory exception
-            g_core->log_info(std::format(L"Exception, attempt to prefetch unmapped memory at: {:#08x}\n", (int32_t)interp_addr));
-            stop = 1;
-        }
+    switch ((op >> 26) & 0x3F)
+    {
+    case 0:
+        return interp_special[op & 0x3F];
+    case 1:
+        return interp_regimm[(op >> 16) & 0x1F];
+    case 16:
+        if (((op >> 21) & 0x1F) == 16)
+            return interp_tlb[op & 0x3F];
+        return interp_cop0[(op >> 21) & 0x1F];
+    default:
+        return interp_ops[(op >> 26) & 0x3F];
     }
-    else
+}
+
+/**
+ * Translates interp_addr, finds the decoded page backing it and maps it to the virtual page.
+ * \return The page, or nullptr if the fetch was already handled by an exception or hit unmapped memory.
+ */
+static t_decoded_page* map_decoded_page()
+{
+    uint32_t phys = interp_addr;
+    if ((interp_addr < 0x80000000) || (interp_addr >= 0xc0000000))
     {
-        uint32_t addr = interp_addr, phys;
         phys = virtual_to_physical_address(interp_addr, 2);
-        if (phys != 0x00000000)
-            interp_addr = phys;
-        else
+        if (phys == 0x00000000)
         {
+            // The TLB exception moved interp_addr to the exception vector
             prefetch();
-            // tlb_used = 0;
-            return;
+            return nullptr;
         }
-        // tlb_used = 1;
-        prefetch();
-        // tlb_used = 0;
-        interp_addr = addr;
-        return;
     }
+
+    const uint32_t* memory;
+    if ((phys >= 0x80000000) && (phys < 0x80800000))
+    {
+        memory = (uint32_t*)rdram + (phys & 0x7FF000) / 4;
+    }
+    else if ((phys >= 0xa4000000) && (phys < 0xa4001000))
+    {
+        memory = SP_DMEM;
+    }
+    else if ((phys > 0xb0000000) && (phys < 0xc0000000))
+    {
+        memory = (uint32_t*)rom + (phys & 0xFFFF000) / 4;
+    }
+    else
+    {
+        // unmapped memory exception
+        g_core->log_info(std::format(L"Exception, attempt to prefetch unmapped memory at: {:#08x}\n", (int32_t)phys));
+        stop = 1;
+        return nullptr;
+    }
+
+    auto& page = g_decoded_pages[(phys & 0x1FFFFFFF) >> 12];
+    if (!page)
+    {
+        page = std::make_unique<t_decoded_page>();
+        page->memory = memory;
+    }
+    g_decoded_vpages[interp_addr >> 12] = page.get();
+    invalid_code[interp_addr >> 12] = 0;
+    return page.get();
+}
+
+/**
+ * Frees the decoded pages and drops every virtual page mapping.
+ */
+static void free_decoded_pages()
+{
+    for (auto& page : g_decoded_pages)
+        page.reset();
+    memset(g_decoded_vpages, 0, sizeof(g_decoded_vpages));
+    memset(invalid_code, 1, sizeof(invalid_code));
+}
+
+// Get opcode from address (interp_address) and point PC at its decoded entry
+void prefetch()
+{
+    t_decoded_page* page = g_decoded_vpages[interp_addr >> 12];
+    if (invalid_code[interp_addr >> 12] || !page)
+    {
+        page = map_decoded_page();
+        if (!page)
+            return;
+    }
+
+    const uint32_t i = (interp_addr & 0xFFF) / 4;
+    vr_op = page->memory[i];
+    PC = &page->instrs[i];
+
+    // Writes invalid_code doesn't track (RSP, DMA, plugins) can change the word, so the tag is always checked
+    if (!PC->ops || PC->src != vr_op)
+    {
+        prefetch_opcode(vr_op);
+        PC->ops = resolve_handler(vr_op);
+        PC->src = vr_op;
+    }
+
     if (core_vr_is_tracelog_active())
         tracelog_log_pure();
 }
@@ -3159,7 +3234,9 @@ void pure_interpreter()
 {
     interp_addr = 0xa4000040;
     stop = 0;
-    PC = (precomp_instr*)malloc(sizeof(precomp_instr));
+    free_decoded_pages();
+    precomp_instr* const pc = (precomp_instr*)malloc(sizeof(precomp_instr));
+    PC = pc;
     last_addr = interp_addr;
     core_executing = true;
     g_core->callbacks.core_executing_changed(core_executing);
@@ -3172,7 +3249,7 @@ void pure_interpreter()
 
         // if (Count > 0x2000000) g_core->log_info(L"inter:%x,%x", interp_addr,op);
         // if ((Count+debug_count) > 0xabaa2c) stop=1;
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
         g_vr_beq_ignore_jmp = false;
 
         // Count = (uint32_t)Count + 2;
@@ -3183,7 +3260,10 @@ void pure_interpreter()
         }
         Debugger::on_late_cycle(vr_op, interp_addr);
     }
+    // PC points into the decoded pages, which don't outlive the core
+    PC = pc;
     PC->addr = interp_addr;
+    free_decoded_pages();
 }
 
 void interprete_section(uint32_t addr)
@@ -3197,7 +3277,7 @@ void interprete_section(uint32_t addr)
         if (core_vr_is_tracelog_active())
             tracelog_log_pure();
         PC->addr = interp_addr;
-        interp_ops[((vr_op >> 26) & 0x3F)]();
+        PC->ops();
     }
     PC->addr = interp_addr;
 }
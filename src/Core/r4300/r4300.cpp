@@ -8,6 +8,7 @@
 #include <Core.h>
 #include <memory/memory.h>
 #include <memory/pif.h>
+#include <memory/save_media.h>
 #include <memory/savestates.h>
 #include <r4300/exception.h>
 #include <r4300/interrupt.h>
@@ -69,19 +70,11 @@ bool g_vr_fast_forward;
 bool g_vr_frame_skipped;
 core_system_type g_sys_type;
 
-FILE* g_eeprom_file;
-FILE* g_sram_file;
-FILE* g_fram_file;
-FILE* g_mpak_file;
-
 /*#define check_memory() \
    if (!invalid_code[address>>12]) \
        invalid_code[address>>12] = 1;*/
 
-#define check_memory()                                                              \
-    if (!invalid_code[address >> 12])                                               \
-        if (blocks[address >> 12]->block[(address & 0xFFF) / 4].ops != NOTCOMPILED) \
-            invalid_code[address >> 12] = 1;
+#define check_memory() invalidate_code(address)
 
 void core_vr_invalidate_visuals()
 {
@@ -1589,6 +1582,9 @@ inline void jump_to_func()
     paddr = update_invalid_addr(addr);
     if (!paddr)
         return;
+    // We're about to redirect execution, so nothing will return into the code cache.
+    if (dynacore && exec_arena_full())
+        dyna_flush_code_cache();
     actual = blocks[addr >> 12];
     if (invalid_code[addr >> 12])
     {
@@ -1649,6 +1645,7 @@ void init_blocks()
         invalid_code[i] = 1;
         blocks[i] = NULL;
     }
+    memset(recompile_counts, 0, sizeof(recompile_counts));
     blocks[0xa4000000 >> 12] = (precomp_block*)malloc(sizeof(precomp_block));
     invalid_code[0xa4000000 >> 12] = 1;
     blocks[0xa4000000 >> 12]->code = NULL;
@@ -1967,6 +1964,8 @@ void core_start()
             blocks[i] = NULL;
         }
     }
+    dyna_clear_links();
+    exec_arena_reset();
     if (!dynacore && interpcore)
         free(PC);
     core_executing = false;
@@ -1997,34 +1996,44 @@ bool open_core_file_stream(const std::filesystem::path& path, FILE** file)
 
 void clear_save_data()
 {
-    open_core_file_stream(get_eeprom_path(), &g_eeprom_file);
-    open_core_file_stream(get_sram_path(), &g_sram_file);
-    open_core_file_stream(get_flashram_path(), &g_fram_file);
-    open_core_file_stream(get_mempak_path(), &g_mpak_file);
+    FILE* eeprom_file = nullptr;
+    FILE* sram_file = nullptr;
+    FILE* fram_file = nullptr;
+    FILE* mpak_file = nullptr;
+
+    open_core_file_stream(get_eeprom_path(), &eeprom_file);
+    open_core_file_stream(get_sram_path(), &sram_file);
+    open_core_file_stream(get_flashram_path(), &fram_file);
+    open_core_file_stream(get_mempak_path(), &mpak_file);
 
+    if (sram_file)
     {
         memset(sram, 0, sizeof(sram));
-        fseek(g_sram_file, 0, SEEK_SET);
-        fwrite(sram, 1, 0x8000, g_sram_file);
+        fseek(sram_file, 0, SEEK_SET);
+        fwrite(sram, 1, 0x8000, sram_file);
+        fclose(sram_file);
     }
+    if (eeprom_file)
     {
         memset(eeprom, 0, sizeof(eeprom));
-        fseek(g_eeprom_file, 0, SEEK_SET);
-        fwrite(eeprom, 1, 0x800, g_eeprom_file);
+        fseek(eeprom_file, 0, SEEK_SET);
+        fwrite(eeprom, 1, 0x800, eeprom_file);
+        fclose(eeprom_file);
     }
+    if (mpak_file)
     {
-        fseek(g_mpak_file, 0, SEEK_SET);
+        fseek(mpak_file, 0, SEEK_SET);
         for (auto buf : mempack)
         {
             memset(buf, 0, sizeof(mempack) / 4);
-            fwrite(buf, 1, 0x800, g_mpak_file);
+            fwrite(buf, 1, 0x800, mpak_file);
         }
+        fclose(mpak_file);
+    }
+    if (fram_file)
+    {
+        fclose(fram_file);
     }
-
-    fclose(g_eeprom_file);
-    fclose(g_sram_file);
-    fclose(g_fram_file);
-    fclose(g_mpak_file);
 }
 
 void audio_thread()
@@ -2125,14 +2134,7 @@ core_result vr_close_rom_impl(bool stop_vcr)
 
     emu_thread_handle.join();
 
-    fflush(g_eeprom_file);
-    fflush(g_sram_file);
-    fflush(g_fram_file);
-    fflush(g_mpak_file);
-    fclose(g_eeprom_file);
-    fclose(g_sram_file);
-    fclose(g_fram_file);
-    fclose(g_mpak_file);
+    save_media_close();
 
     return Res_Ok;
 }
@@ -2155,7 +2157,7 @@ core_result vr_start_rom_impl(std::filesystem::path path)
     g_core->callbacks.emu_starting_changed(true);
 
     // If we get a movie instead of a rom, we try to search the available rom lists to find one matching the movie
-    if (path.extension() == ".m64")
+    if (path.extension() == ".m64" || path.extension() == ".m64z")
     {
         core_vcr_movie_header movie_header{};
         const auto result = core_vcr_parse_header(path, &movie_header);
@@ -2193,8 +2195,8 @@ core_result vr_start_rom_impl(std::filesystem::path path)
         return VR_RomInvalid;
     }
 
-    // Open all the save file streams
-    if (!open_core_file_stream(get_eeprom_path(), &g_eeprom_file) || !open_core_file_stream(get_sram_path(), &g_sram_file) || !open_core_file_stream(get_flashram_path(), &g_fram_file) || !open_core_file_stream(get_mempak_path(), &g_mpak_file))
+    // Load all the save media
+    if (!save_media_open(save_media_eeprom, get_eeprom_path()) || !save_media_open(save_media_sram, get_sram_path()) || !save_media_open(save_media_flashram, get_flashram_path()) || !save_media_open(save_media_mempak, get_mempak_path()))
     {
         g_core->callbacks.emu_starting_changed(false);
         return VR_FileOpenFailed;
@@ -58,11 +58,6 @@ extern bool g_vr_fast_forward;
 extern bool g_vr_frame_skipped;
 extern core_system_type g_sys_type;
 
-extern FILE* g_eeprom_file;
-extern FILE* g_sram_file;
-extern FILE* g_fram_file;
-extern FILE* g_mpak_file;
-
 extern bool g_vr_benchmark_enabled;
 
 void pure_interpreter();
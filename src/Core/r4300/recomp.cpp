@@ -22,6 +22,8 @@ precomp_instr* dst; // destination structure for the recompiled instruction
 int32_t code_length; // current real recompiled code length
 int32_t max_code_length; // current recompiled code's buffer length
 unsigned char** inst_pointer; // output buffer for recompiled code
+std::atomic<size_t> g_code_cache_flushes; // amount of times the code cache ran full and was flushed
+uint32_t recompile_counts[0x100000];
 precomp_block* dst_block; // the current block that we are recompiling
 uint32_t src; // the current recompiled instruction
 int32_t fast_memory;
@@ -2480,8 +2482,14 @@ void init_block(int32_t* source, precomp_block* block)
         block->block = (precomp_instr*)malloc(((length + 1) + (length >> 2)) * sizeof(precomp_instr));
         already_exist = 0;
     }
+    else if (dynacore && !block->code)
+    {
+        // The code cache was flushed, so the NOTCOMPILED stubs have to be emitted again
+        already_exist = 0;
+    }
     if (dynacore)
     {
+        dyna_unlink_block(block, true);
         if (!block->code)
         {
             block->code = (unsigned char*)malloc_exec(CODE_BLOCK_SIZE);
@@ -2501,6 +2509,9 @@ void init_block(int32_t* source, precomp_block* block)
         init_cache(block->block);
     }
 
+    memset(block->compiled, 0, sizeof(block->compiled));
+    block->mapped = false;
+
     if (!already_exist)
     {
         for (i = 0; i < length; i++)
@@ -2615,9 +2626,12 @@ void recompile_block(int32_t* source, precomp_block* block, uint32_t func)
     dst_block = block;
 
     block->hash = 0;
+    ++recompile_counts[block->start >> 12];
 
     if (dynacore)
     {
+        // Recompiling may move the block's code, so exits linked into it must be restored first
+        dyna_unlink_block(block, false);
         code_length = block->code_length;
         max_code_length = block->max_code_length;
         inst_pointer = &block->code;
@@ -2633,7 +2647,11 @@ void recompile_block(int32_t* source, precomp_block* block, uint32_t func)
             virtual_to_physical_address(block->start + i * 4, 0);
             if (blocks[address2 >> 12]->block[(address2 & 0xFFF) / 4].ops == NOTCOMPILED)
                 blocks[address2 >> 12]->block[(address2 & 0xFFF) / 4].ops = NOTCOMPILED2;
+            blocks[address2 >> 12]->compiled[(address2 & 0xFFF) / 128] |= 1 << ((address2 & 0xFFF) / 4 % 32);
+            blocks[address2 >> 12]->mapped = true;
         }
+        if (i < length)
+            block->compiled[i / 32] |= 1 << (i % 32);
 
         SRC = source + i;
         src = source[i];
@@ -2646,7 +2664,7 @@ void recompile_block(int32_t* source, precomp_block* block, uint32_t func)
         dst->reg_cache_infos.need_map = 0;
         dst->local_addr = code_length;
         recomp_ops[((src >> 26) & 0x3F)]();
-        if (core_vr_is_tracelog_active())
+        if (core_vr_is_tracelog_active() && tracelog_filter_instruction(dst->addr, src))
         {
             dst->s_ops = dst->ops;
             dst->ops = tracelog_log_interp_ops;
@@ -2838,6 +2856,137 @@ uint32_t PAddr(uint32_t addr)
     }
 }
 
+void dyna_flush_code_cache()
+{
+    g_core->log_info(std::format(L"Flushing code cache ({} bytes used)", exec_arena_used()));
+
+    for (size_t i = 0; i < std::size(blocks); ++i)
+    {
+        const auto block = blocks[i];
+        if (!block)
+            continue;
+
+        if (block->code)
+        {
+            free_exec(block->code);
+            block->code = NULL;
+        }
+        if (block->jumps_table)
+        {
+            free(block->jumps_table);
+            block->jumps_table = NULL;
+        }
+        // Prevents the TLB from revalidating the block without recompiling it
+        block->hash = 0;
+        invalid_code[i] = 1;
+    }
+
+    dyna_clear_links();
+    exec_arena_reset();
+    ++g_code_cache_flushes;
+}
+
+/**
+ * Resets a single compiled instruction so it gets recompiled from memory the next time it's executed.
+ */
+static bool reset_compiled_word(uint32_t address)
+{
+    const uint32_t page = address >> 12;
+    const uint32_t word = (address & 0xFFF) / 4;
+    precomp_block* block = blocks[page];
+
+    if (invalid_code[page] || !block || !(block->compiled[word / 32] & (1 << (word % 32))))
+        return false;
+
+    block->block[word].ops = NOTCOMPILED;
+    block->compiled[word / 32] &= ~(1 << (word % 32));
+    return true;
+}
+
+void invalidate_code(uint32_t address)
+{
+    const uint32_t page = address >> 12;
+    const uint32_t word = (address & 0xFFF) / 4;
+    precomp_block* block = blocks[page];
+
+    if (invalid_code[page] || !(block->compiled[word / 32] & (1 << (word % 32))))
+        return;
+
+    // The dynarec's code for an instruction falls through into the next one with registers still cached,
+    // and code compiled through the TLB lives in the virtual page, so those need the whole page rebuilt.
+    if (dynacore || block->mapped || address < 0x80000000 || address >= 0xc0000000)
+    {
+        invalid_code[page] = 1;
+        return;
+    }
+
+    // Cached interpreter instructions are independent, so only the overwritten one has to go.
+    // The kseg0/kseg1 alias has its own block, which needs the same treatment.
+    const uint32_t alias = address ^ 0x20000000;
+    if (blocks[alias >> 12] && blocks[alias >> 12]->mapped)
+    {
+        invalid_code[page] = 1;
+        invalid_code[alias >> 12] = 1;
+        return;
+    }
+    reset_compiled_word(address);
+    reset_compiled_word(alias);
+
+    // The preceding instruction may be a branch compiled into an *_IDLE op because this word was a NOP when it was compiled.
+    // Those skip the delay slot entirely, so the branch has to be recompiled as well to pick up the new delay slot.
+    // A branch in the previous page can't be reset on its own without checking that page's mapping, so the whole page goes instead.
+    if (word == 0)
+    {
+        invalid_code[(address - 4) >> 12] = 1;
+        invalid_code[(alias - 4) >> 12] = 1;
+        return;
+    }
+    reset_compiled_word(address - 4);
+    reset_compiled_word(alias - 4);
+}
+
+void reset_current_block()
+{
+    if (dynacore || !PC)
+        return;
+
+    precomp_block* block = blocks[PC->addr >> 12];
+    if (!block || !block->block)
+        return;
+
+    const uint32_t length = (block->end - block->start) / 4;
+    if (PC < block->block || PC >= block->block + length)
+        return;
+
+    for (uint32_t i = 0; i < length; i++)
+        block->block[i].ops = NOTCOMPILED;
+    memset(block->compiled, 0, sizeof(block->compiled));
+}
+
+core_code_cache_stats core_vr_get_code_cache_stats()
+{
+    return core_code_cache_stats{
+    .capacity = EXEC_ARENA_SIZE,
+    .used = exec_arena_used(),
+    .flushes = g_code_cache_flushes,
+    };
+}
+
+void core_vr_get_recompile_counts(std::vector<core_page_recompiles>& pages)
+{
+    pages.clear();
+    for (uint32_t i = 0; i < std::size(recompile_counts); ++i)
+    {
+        if (!recompile_counts[i])
+            continue;
+        pages.push_back(core_page_recompiles{
+        .address = i << 12,
+        .recompiles = recompile_counts[i],
+        });
+    }
+    std::ranges::sort(pages, std::greater{}, &core_page_recompiles::recompiles);
+}
+
 void core_vr_recompile(uint32_t addr)
 {
     if (addr == UINT32_MAX)
@@ -68,6 +68,10 @@ typedef struct _precomp_block {
     void* jumps_table;
     int32_t jumps_number;
     uint64_t hash;
+    // Bitmap of the instructions in this page which have been compiled since the last init_block.
+    uint32_t compiled[32];
+    // Whether code in this page has been compiled through a TLB mapping.
+    bool mapped;
 } precomp_block;
 
 void recompile_block(int32_t* source, precomp_block* block, uint32_t func);
@@ -78,4 +82,41 @@ void dyna_jump();
 void dyna_start(void (*code)());
 void dyna_stop();
 
+/**
+ * Discards all recompiled code and invalidates every block, reclaiming the whole code cache.
+ * Must only be called when no recompiled code will be returned into, e.g. right before a dyna_jump.
+ */
+void dyna_flush_code_cache();
+
+/**
+ * Called by linkable block exits instead of jump_to_func. Performs the jump and, if possible, links the exit directly to the target's code.
+ */
+void dyna_link_jump();
+
+/**
+ * Unlinks every exit which jumps directly into the specified block.
+ * \param block The block.
+ * \param discard_exits Whether to also forget the linked exits contained in the block, because its code is about to be rewritten.
+ */
+void dyna_unlink_block(precomp_block* block, bool discard_exits);
+
+/**
+ * Forgets all block links. Only valid when all recompiled code is discarded.
+ */
+void dyna_clear_links();
+
+/**
+ * Notifies the recompiler of a write to the specified address, invalidating compiled code at that address if needed.
+ */
+void invalidate_code(uint32_t address);
+
+/**
+ * Resets the cached interpreter's block that is currently executing, so each instruction gets recompiled when execution reaches it.
+ * The entries stay in place, so PC remains valid. Does nothing under the dynarec.
+ */
+void reset_current_block();
+
+// The amount of times recompile_block ran for each page.
+extern uint32_t recompile_counts[0x100000];
+
 extern precomp_instr* dst;
@@ -264,6 +264,7 @@ void genlwu();
 void gensdl();
 void gensdr();
 void genlink_subblock();
+void genlink_jump_out(uint32_t addr);
 void gendelayslot();
 void gencheck_interrupt_reg();
 void gentest();
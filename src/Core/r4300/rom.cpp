@@ -12,7 +12,61 @@
 #include <r4300/r4300.h>
 #include <r4300/rom.h>
 
-std::unordered_map<std::filesystem::path, std::pair<uint8_t*, size_t>> rom_cache;
+#ifdef WIN32
+#include <Windows.h>
+#endif
+
+// ROMs are cached on disk in their normalized form (byteswapped to host word order), together with their cleaned-up header and MD5 hash.
+// Cache files are keyed by the XXH64 hash of the ROM file's contents and mapped copy-on-write when launching, so a cached ROM is neither
+// decompressed, byteswapped nor hashed again, and the image's pages are shared with the OS file cache until something writes to them.
+
+constexpr char ROM_CACHE_MAGIC[4] = {'M', '6', '4', 'R'};
+
+/**
+ * The current version of the ROM cache file format. Bump whenever the normalization changes.
+ */
+constexpr uint32_t ROM_CACHE_VERSION = 1;
+
+/**
+ * The offset of the normalized image within a ROM cache file. Page-aligned, so the mapped image is too.
+ */
+constexpr size_t ROM_CACHE_IMAGE_OFFSET = 0x2000;
+
+/**
+ * The size of the blocks ROM files are hashed in. xxh64's constexpr implementation recurses once per 32 bytes, which would overflow the stack on whole ROMs.
+ */
+constexpr size_t ROM_CACHE_HASH_BLOCK_SIZE = 0x10000;
+
+/**
+ * The size the ROM buffer is padded to when SD card emulation is enabled.
+ */
+constexpr size_t SUMMERCART_ROM_SIZE = 0x4000000;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t rom_size;
+    char md5[32];
+    core_rom_header header;
+} t_rom_cache_header;
+
+static_assert(sizeof(t_rom_cache_header) <= ROM_CACHE_IMAGE_OFFSET);
+
+/**
+ * A ROM file whose cache key is already known, used to skip reading and hashing it again as long as it wasn't modified.
+ */
+typedef struct {
+    uintmax_t file_size;
+    std::filesystem::file_time_type last_write_time;
+    uint64_t key;
+} t_rom_cache_entry;
+
+static std::unordered_map<std::filesystem::path, t_rom_cache_entry> rom_cache;
+
+#ifdef WIN32
+// The base of the view the ROM is mapped from, or nullptr if the ROM buffer is heap-allocated.
+static uint8_t* rom_view;
+#endif
 
 uint8_t* rom;
 size_t rom_size;
@@ -131,23 +185,255 @@ void core_vr_byteswap(uint8_t* rom)
     }
 }
 
-bool rom_load(std::filesystem::path path)
+static void rom_free()
 {
-    if (rom)
+    if (!rom)
+    {
+        return;
+    }
+
+#ifdef WIN32
+    if (rom_view)
+    {
+        UnmapViewOfFile(rom_view);
+        rom_view = nullptr;
+    }
+    else
+#endif
     {
         free(rom);
-        g_core->rom = rom = nullptr;
     }
 
-    if (rom_cache.contains(path))
+    g_core->rom = rom = nullptr;
+}
+
+static void update_sys_type()
+{
+    switch (ROM_HEADER.Country_code & 0xFF)
+    {
+    case 0x44:
+    case 0x46:
+    case 0x49:
+    case 0x50:
+    case 0x53:
+    case 0x55:
+    case 0x58:
+    case 0x59:
+        g_sys_type = sys_pal;
+        break;
+    case 0x37:
+    case 0x41:
+    case 0x45:
+    case 0x4a:
+        g_sys_type = sys_ntsc;
+        break;
+    default:
+        g_core->log_warn(std::format(L"Unknown ccode: {:#06x}. Assuming PAL.", ROM_HEADER.Country_code));
+        g_sys_type = sys_pal;
+        break;
+    }
+}
+
+static uint64_t rom_cache_hash(const std::span<const uint8_t> data)
+{
+    uint64_t hash = 0;
+    for (size_t i = 0; i < data.size(); i += ROM_CACHE_HASH_BLOCK_SIZE)
+    {
+        hash = xxh64::hash((const char*)data.data() + i, std::min(ROM_CACHE_HASH_BLOCK_SIZE, data.size() - i), hash);
+    }
+    return hash;
+}
+
+static std::filesystem::path rom_cache_path(const uint64_t key)
+{
+    return g_core->get_cache_directory() / std::format(L"{:016X}.rom", key);
+}
+
+/**
+ * Maps a cached ROM and initializes the rom module's globals from it.
+ * \param key The ROM file's cache key.
+ * \return Whether the ROM was found in the cache.
+ */
+static bool rom_cache_load(const uint64_t key)
+{
+#ifdef WIN32
+    const auto path = rom_cache_path(key);
+
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER file_size{};
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &file_size) && (uint64_t)file_size.QuadPart > ROM_CACHE_IMAGE_OFFSET)
+    {
+        mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+
+    if (!mapping)
+    {
+        return false;
+    }
+
+    // The view keeps the mapping alive
+    const auto view = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+
+    if (!view)
+    {
+        return false;
+    }
+
+    const auto header = (const t_rom_cache_header*)view;
+    if (memcmp(header->magic, ROM_CACHE_MAGIC, sizeof(ROM_CACHE_MAGIC)) || header->version != ROM_CACHE_VERSION || header->rom_size != (uint64_t)file_size.QuadPart - ROM_CACHE_IMAGE_OFFSET)
+    {
+        g_core->log_warn(std::format(L"[Core] Ignoring invalid ROM cache file {}", path.wstring()));
+        UnmapViewOfFile(view);
+        return false;
+    }
+
+    rom_size = header->rom_size;
+    ROM_HEADER = header->header;
+    memcpy(rom_md5, header->md5, sizeof(header->md5));
+    rom_md5[sizeof(header->md5)] = '\0';
+
+    if (g_core->cfg->use_summercart && rom_size < SUMMERCART_ROM_SIZE)
+    {
+        // The buffer must be larger than the image, which a view of the file can't provide
+        rom = (uint8_t*)malloc(SUMMERCART_ROM_SIZE);
+        memcpy(rom, view + ROM_CACHE_IMAGE_OFFSET, rom_size);
+        UnmapViewOfFile(view);
+    }
+    else
+    {
+        rom_view = view;
+        rom = view + ROM_CACHE_IMAGE_OFFSET;
+    }
+    g_core->rom = rom;
+
+    // Refresh the modification time so eviction drops the least recently used ROMs first
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Writes the currently loaded ROM to the cache and evicts the least recently used cached ROMs exceeding the configured cache size.
+ */
+static void rom_cache_store(const uint64_t key)
+{
+    const auto directory = g_core->get_cache_directory();
+    const auto path = rom_cache_path(key);
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    t_rom_cache_header header{};
+    memcpy(header.magic, ROM_CACHE_MAGIC, sizeof(ROM_CACHE_MAGIC));
+    header.version = ROM_CACHE_VERSION;
+    header.rom_size = rom_size;
+    memcpy(header.md5, rom_md5, sizeof(header.md5));
+    header.header = ROM_HEADER;
+
+    std::vector<uint8_t> header_page(ROM_CACHE_IMAGE_OFFSET);
+    memcpy(header_page.data(), &header, sizeof(header));
+
+    auto tmp_path = path;
+    tmp_path += L".tmp";
+
+    FILE* f = nullptr;
+    if (fopen_s(&f, tmp_path.string().c_str(), "wb"))
+    {
+        g_core->log_error(std::format(L"[Core] Failed to open {} for writing", tmp_path.wstring()));
+        return;
+    }
+
+    const bool written = fwrite(header_page.data(), 1, header_page.size(), f) == header_page.size() && fwrite(rom, 1, rom_size, f) == rom_size;
+    const bool closed = fclose(f) == 0;
+
+    if (!written || !closed)
+    {
+        g_core->log_error(std::format(L"[Core] Failed to write {}", tmp_path.wstring()));
+        std::filesystem::remove(tmp_path, ec);
+        return;
+    }
+
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        g_core->log_error(std::format(L"[Core] Failed to replace {}: {}", path.wstring(), string_to_wstring(ec.message())));
+        std::filesystem::remove(tmp_path, ec);
+        return;
+    }
+
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+    {
+        if (entry.is_regular_file(ec) && entry.path().extension() == L".rom")
+        {
+            files.emplace_back(entry.last_write_time(ec), entry.path());
+        }
+    }
+
+    if (files.size() <= (size_t)g_core->cfg->rom_cache_size)
+    {
+        return;
+    }
+
+    std::ranges::sort(files);
+    for (size_t i = 0; i < files.size() - g_core->cfg->rom_cache_size; ++i)
+    {
+        g_core->log_info(std::format(L"[Core] Evicting cached ROM {}", files[i].second.wstring()));
+        std::filesystem::remove(files[i].second, ec);
+    }
+}
+
+bool rom_load(std::filesystem::path path)
+{
+    rom_free();
+
+    const bool cache_enabled = g_core->cfg->rom_cache_size > 0;
+
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    const auto last_write_time = ec ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(path, ec);
+    const bool indexable = cache_enabled && !ec;
+
+    std::vector<uint8_t> rom_buf;
+    uint64_t key{};
+
+    if (indexable)
     {
-        g_core->log_info(L"[Core] Loading cached ROM...");
-        g_core->rom = rom = (unsigned char*)malloc(rom_cache[path].second);
-        memcpy(rom, rom_cache[path].first, rom_cache[path].second);
-        return true;
+        if (const auto it = rom_cache.find(path); it != rom_cache.end() && it->second.file_size == file_size && it->second.last_write_time == last_write_time)
+        {
+            key = it->second.key;
+        }
+        else
+        {
+            rom_buf = read_file_buffer(path);
+            key = rom_cache_hash(rom_buf);
+            rom_cache[path] = {file_size, last_write_time, key};
+        }
+
+        if (rom_cache_load(key))
+        {
+            g_core->log_info(L"[Core] Loaded cached ROM");
+            update_sys_type();
+            return true;
+        }
     }
 
-    auto rom_buf = read_file_buffer(path);
+    if (rom_buf.empty())
+    {
+        rom_buf = read_file_buffer(path);
+    }
     auto decompressed_rom = auto_decompress(rom_buf);
 
     if (decompressed_rom.empty())
@@ -157,8 +443,8 @@ bool rom_load(std::filesystem::path path)
 
     rom_size = decompressed_rom.size();
     uint32_t taille = rom_size;
-    if (g_core->cfg->use_summercart && taille < 0x4000000)
-        taille = 0x4000000;
+    if (g_core->cfg->use_summercart && taille < SUMMERCART_ROM_SIZE)
+        taille = SUMMERCART_ROM_SIZE;
 
     g_core->rom = rom = (unsigned char*)malloc(taille);
     memcpy(rom, decompressed_rom.data(), rom_size);
@@ -221,36 +507,12 @@ bool rom_load(std::filesystem::path path)
     for (size_t i = 0; i < (rom_size / 4); i++)
         roml[i] = sl(roml[i]);
 
-    switch (ROM_HEADER.Country_code & 0xFF)
-    {
-    case 0x44:
-    case 0x46:
-    case 0x49:
-    case 0x50:
-    case 0x53:
-    case 0x55:
-    case 0x58:
-    case 0x59:
-        g_sys_type = sys_pal;
-        break;
-    case 0x37:
-    case 0x41:
-    case 0x45:
-    case 0x4a:
-        g_sys_type = sys_ntsc;
-        break;
-    default:
-        g_core->log_warn(std::format(L"Unknown ccode: {:#06x}. Assuming PAL.", ROM_HEADER.Country_code));
-        g_sys_type = sys_pal;
-        break;
-    }
+    update_sys_type();
 
-    if (rom_cache.size() < g_core->cfg->rom_cache_size)
+    if (indexable)
     {
-        g_core->log_info(std::format(L"[Core] Putting ROM in cache... ({}/{} full)\n", rom_cache.size(), g_core->cfg->rom_cache_size));
-        auto data = (uint8_t*)malloc(taille);
-        memcpy(data, rom, taille);
-        rom_cache[path] = std::make_pair(data, taille);
+        g_core->log_info(L"[Core] Putting ROM in cache...");
+        rom_cache_store(key);
     }
 
     return true;
@@ -7,6 +7,7 @@
 #include "stdafx.h"
 #include <Core.h>
 #include <r4300/timers.h>
+#include <r4300/perf.h>
 #include <include/core_api.h>
 #include <memory/pif.h>
 #include <r4300/r4300.h>
@@ -14,14 +15,71 @@
 extern int32_t m_current_vi;
 extern int32_t m_current_sample;
 
+/**
+ * A single-producer ring of timer deltas published via a seqlock.
+ * Only the emu thread writes, readers retry their snapshot if a write overlapped it.
+ */
+typedef struct {
+    std::atomic<uint32_t> seq;
+    std::atomic<int64_t> deltas[core_timer_max_deltas];
+    size_t ptr;
+    std::atomic<bool> reset_pending;
+} t_delta_ring;
+
 std::chrono::duration<double, std::milli> max_vi_s_ms;
 
-size_t frame_deltas_ptr = 0;
-size_t vi_deltas_ptr = 0;
+static t_delta_ring frame_ring{};
+static t_delta_ring vi_ring{};
 
 time_point last_vi_time;
 time_point last_frame_time;
 
+static void ring_push(t_delta_ring& ring, const core_timer_delta delta)
+{
+    const auto seq = ring.seq.load(std::memory_order_relaxed);
+    ring.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Resets may be requested from any thread, so they're deferred to the producer to keep it the only writer
+    if (ring.reset_pending.exchange(false, std::memory_order_relaxed))
+    {
+        for (auto& slot : ring.deltas)
+        {
+            slot.store(0, std::memory_order_relaxed);
+        }
+        ring.ptr = 0;
+    }
+
+    ring.deltas[ring.ptr].store(delta.count(), std::memory_order_relaxed);
+    ring.ptr = (ring.ptr + 1) % core_timer_max_deltas;
+
+    ring.seq.store(seq + 2, std::memory_order_release);
+}
+
+static void ring_snapshot(const t_delta_ring& ring, core_timer_deltas& deltas)
+{
+    while (true)
+    {
+        const auto seq = ring.seq.load(std::memory_order_acquire);
+        if (seq & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (size_t i = 0; i < core_timer_max_deltas; ++i)
+        {
+            deltas[i] = core_timer_delta(ring.deltas[i].load(std::memory_order_relaxed));
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (ring.seq.load(std::memory_order_relaxed) == seq)
+        {
+            return;
+        }
+    }
+}
+
 void core_vr_on_speed_modifier_changed()
 {
     const double max_vi_s = core_vr_get_vis_per_second(ROM_HEADER.Country_code);
@@ -31,27 +89,27 @@ void core_vr_on_speed_modifier_changed()
     last_frame_time = std::chrono::high_resolution_clock::now();
     last_vi_time = std::chrono::high_resolution_clock::now();
 
-    for (auto& delta : g_core->g_frame_deltas)
-    {
-        delta = {};
-    }
-    for (auto& delta : g_core->g_vi_deltas)
-    {
-        delta = {};
-    }
+    frame_ring.reset_pending = true;
+    vi_ring.reset_pending = true;
+}
 
-    frame_deltas_ptr = 0;
-    vi_deltas_ptr = 0;
+void core_vr_get_frame_deltas(core_timer_deltas& deltas)
+{
+    ring_snapshot(frame_ring, deltas);
+}
+
+void core_vr_get_vi_deltas(core_timer_deltas& deltas)
+{
+    ring_snapshot(vi_ring, deltas);
 }
 
 void timer_new_frame()
 {
     const auto current_frame_time = std::chrono::high_resolution_clock::now();
 
-    g_core->g_frame_deltas_mutex.lock();
-    g_core->g_frame_deltas[frame_deltas_ptr] = current_frame_time - last_frame_time;
-    g_core->g_frame_deltas_mutex.unlock();
-    frame_deltas_ptr = (frame_deltas_ptr + 1) % core_timer_max_deltas;
+    perf_record(core_perf_frame, current_frame_time - last_frame_time);
+
+    ring_push(frame_ring, current_frame_time - last_frame_time);
 
     g_core->callbacks.frame();
     last_frame_time = std::chrono::high_resolution_clock::now();
@@ -89,6 +147,7 @@ void timer_new_vi()
                 // sleeping inaccuracy is difference between actual time spent sleeping and the goal sleep
                 // this value isnt usually too large
                 last_sleep_error = end_sleep - start_sleep - goal_sleep;
+                perf_record(core_perf_sleep_error, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::abs(last_sleep_error)));
 
                 // This value is used later to calculate the deltas so we need to reassign it here to cut out the sleep time from the current delta
                 current_vi_time = std::chrono::high_resolution_clock::now();
@@ -105,10 +164,9 @@ void timer_new_vi()
         }
     }
 
-    g_core->g_vi_deltas_mutex.lock();
-    g_core->g_vi_deltas[vi_deltas_ptr] = current_vi_time - last_vi_time;
-    g_core->g_vi_deltas_mutex.unlock();
-    vi_deltas_ptr = (vi_deltas_ptr + 1) % core_timer_max_deltas;
+    perf_record(core_perf_vi, current_vi_time - last_vi_time);
+
+    ring_push(vi_ring, current_vi_time - last_vi_time);
 
     last_vi_time = std::chrono::high_resolution_clock::now();
 }
@@ -8,29 +8,235 @@
 #include "tracelog.h"
 #include "disasm.h"
 #include "r4300.h"
+#include <Core.h>
+#include <libdeflate.h>
 
 bool enabled = false;
-bool use_binary = false;
+core_tl_format g_format = core_tl_format_text;
+bool g_compress = false;
+
+extern int32_t m_current_sample;
+extern std::thread emu_thread_handle;
+
+static core_tl_filter g_filter;
+
+// Whether the current VCR sample lies in the filter's frame window.
+static bool g_window_open;
+
+// The size of a single trace buffer.
+constexpr size_t TL_BUFFER_SIZE = 0x100000;
+
+// The amount of trace buffers in the ring. The emu thread only blocks when all of them are waiting to be written.
+constexpr size_t TL_BUFFER_COUNT = 8;
+
+// The space which must be left in a buffer before logging another instruction.
+constexpr size_t TL_BUFFER_MARGIN = 512;
+
+// The maximum length of a formatted FPU register value. FLT_MAX has 39 integer digits, followed by 7 more characters.
+constexpr size_t TL_FLOAT_MAX_LENGTH = 48;
+
+// The identifier at the start of binary_v2 traces.
+constexpr char TL_V2_MAGIC[4] = {'M', '6', '4', 'T'};
+
+// The binary_v2 header flag for deflate-compressed chunks.
+constexpr uint8_t TL_V2_FLAG_DEFLATE = 1 << 0;
+
+// The size of the binary_v2 opcode dictionary's lookup table, in bits.
+constexpr size_t TL_V2_DICTIONARY_BITS = 12;
+
+// The deflate compression level used for binary_v2 chunks. Tracing is throughput-bound, so this is kept low.
+constexpr int32_t TL_V2_COMPRESSION_LEVEL = 1;
+
+/**
+ * The header at the start of binary_v2 traces.
+ */
+struct t_tl_v2_header {
+    char magic[4];
+    uint8_t version;
+    uint8_t flags;
+    uint16_t reserved;
+};
+
+/**
+ * The header preceding every binary_v2 chunk. Each chunk holds the records of one trace buffer and is decodable on its own.
+ * Records are laid out as:
+ *  varint: zigzag(pc - (previous pc + 4)) << 2 | is_literal << 1 | delay_slot
+ *  is_literal ? u32 opcode, which is appended to the chunk's dictionary : varint dictionary index
+ *  u32 operand values, as many as the opcode's format logs
+ */
+struct t_tl_v2_chunk {
+    // The size of the decoded records.
+    uint32_t length;
+    // The size of the stored data. Equal to length if the chunk is stored uncompressed.
+    uint32_t stored_length;
+};
+
+/**
+ * An entry in the binary_v2 opcode dictionary's lookup table.
+ */
+struct t_tl_v2_dictionary_entry {
+    uint32_t opcode;
+    uint32_t index;
+    uint32_t generation;
+};
+
+/**
+ * A buffer which has been filled by the emu thread and is waiting to be written.
+ */
+struct t_tl_pending_buffer {
+    size_t index;
+    size_t length;
+};
 
 FILE* log_file;
-char traceLoggingBuf[0x10000];
-char* traceLoggingPointer = traceLoggingBuf;
+static std::unique_ptr<char[]> g_buffers[TL_BUFFER_COUNT];
+char* traceLoggingBuf;
+char* traceLoggingPointer;
+
+static std::thread g_writer_thread;
+static std::mutex g_writer_mutex;
+static std::condition_variable g_writer_cv;
+static std::deque<t_tl_pending_buffer> g_pending_buffers;
+static std::vector<size_t> g_free_buffers;
+static bool g_writer_stop;
+
+// Buffers handed to the writer thread.
+static size_t g_buffers_submitted;
+// Buffers the emu thread had to wait for because all of them were pending.
+static size_t g_buffers_stalled;
+// Buffers which couldn't be written completely.
+static size_t g_buffers_dropped;
+
+// Set when a stop was requested from outside the emu thread. The emu thread owns the current buffer while it runs, so it performs the stop itself.
+static bool g_stop_requested;
+static std::mutex g_stop_mutex;
+static std::condition_variable g_stop_cv;
+
+// The binary_v2 encoder state, which is reset for every chunk.
+static t_tl_v2_dictionary_entry g_v2_dictionary[1 << TL_V2_DICTIONARY_BITS];
+static uint32_t g_v2_dictionary_size;
+static uint32_t g_v2_generation;
+static uint32_t g_v2_next_pc;
 
 bool core_vr_is_tracelog_active()
 {
     return enabled;
 }
 
+/**
+ * Writes a buffer of binary_v2 records as a chunk, compressing it if requested.
+ * \return The amount of record bytes written, which is equal to length on success.
+ */
+static size_t write_v2_chunk(const char* data, size_t length)
+{
+    static std::vector<uint8_t> compressed;
+    static std::unique_ptr<libdeflate_compressor, decltype(&libdeflate_free_compressor)> compressor(nullptr, &libdeflate_free_compressor);
+
+    t_tl_v2_chunk chunk{
+    .length = (uint32_t)length,
+    .stored_length = (uint32_t)length,
+    };
+    const void* stored = data;
+
+    if (g_compress && length > 1)
+    {
+        if (!compressor)
+            compressor.reset(libdeflate_alloc_compressor(TL_V2_COMPRESSION_LEVEL));
+        compressed.resize(length - 1);
+
+        // Chunks which don't shrink are stored as-is, which the decoder detects by the lengths being equal
+        if (const size_t size = libdeflate_deflate_compress(compressor.get(), data, length, compressed.data(), compressed.size()))
+        {
+            chunk.stored_length = (uint32_t)size;
+            stored = compressed.data();
+        }
+    }
+
+    if (fwrite(&chunk, sizeof(chunk), 1, log_file) != 1 || fwrite(stored, 1, chunk.stored_length, log_file) != chunk.stored_length)
+        return 0;
+    return length;
+}
+
+/**
+ * Resets the binary_v2 encoder state, so the next record starts a self-contained chunk.
+ */
+static void v2_begin_chunk()
+{
+    g_v2_dictionary_size = 0;
+    g_v2_next_pc = 0;
+
+    // Bumping the generation invalidates the lookup table without clearing it
+    if (++g_v2_generation == 0)
+    {
+        memset(g_v2_dictionary, 0, sizeof(g_v2_dictionary));
+        g_v2_generation = 1;
+    }
+}
+
+static void writer_thread()
+{
+    while (true)
+    {
+        t_tl_pending_buffer pending;
+        {
+            std::unique_lock lock(g_writer_mutex);
+            g_writer_cv.wait(lock, [] {
+                return !g_pending_buffers.empty() || g_writer_stop;
+            });
+            if (g_pending_buffers.empty())
+                return;
+            pending = g_pending_buffers.front();
+            g_pending_buffers.pop_front();
+        }
+
+        const size_t written = g_format == core_tl_format_binary_v2
+        ? write_v2_chunk(g_buffers[pending.index].get(), pending.length)
+        : fwrite(g_buffers[pending.index].get(), 1, pending.length, log_file);
+
+        {
+            std::scoped_lock lock(g_writer_mutex);
+            if (written != pending.length)
+                ++g_buffers_dropped;
+            g_free_buffers.push_back(pending.index);
+        }
+        g_writer_cv.notify_all();
+    }
+}
+
+/**
+ * Hands the current buffer to the writer thread and switches to a free one, waiting for one if needed.
+ */
 void flush_buf()
 {
-    fwrite(traceLoggingBuf, 1, traceLoggingPointer - traceLoggingBuf, log_file);
+    const size_t index = std::distance(g_buffers, std::ranges::find_if(g_buffers, [](const auto& buffer) {
+                                           return buffer.get() == traceLoggingBuf;
+                                       }));
+
+    std::unique_lock lock(g_writer_mutex);
+    g_pending_buffers.push_back(t_tl_pending_buffer{
+    .index = index,
+    .length = (size_t)(traceLoggingPointer - traceLoggingBuf),
+    });
+    ++g_buffers_submitted;
+    g_writer_cv.notify_all();
+
+    if (g_free_buffers.empty())
+    {
+        ++g_buffers_stalled;
+        g_writer_cv.wait(lock, [] {
+            return !g_free_buffers.empty();
+        });
+    }
+
+    traceLoggingBuf = g_buffers[g_free_buffers.back()].get();
     traceLoggingPointer = traceLoggingBuf;
+    g_free_buffers.pop_back();
+    v2_begin_chunk();
 }
 
 void write_buf()
 {
-    const char* const buflength = traceLoggingBuf + sizeof(traceLoggingBuf) -
-    512;
+    const char* const buflength = traceLoggingBuf + TL_BUFFER_SIZE - TL_BUFFER_MARGIN;
     if (traceLoggingPointer >= buflength)
     {
         flush_buf();
@@ -38,119 +244,194 @@ void write_buf()
 }
 
 
-void log_bin(uint32_t pc, uint32_t w)
+/**
+ * Collects the register and address values logged alongside an instruction.
+ * \param decode The decoded instruction.
+ * \param values The values, in binary trace order.
+ * \return The amount of values collected.
+ */
+static size_t collect_operands(const INSTDECODE& decode, uint32_t values[2])
 {
-    char*& p = traceLoggingPointer;
-    INSTDECODE decode;
-    // little endian
-#define HEX8(n)        \
-    *(uint32_t*)p = n; \
-    p += 4
-
-    DecodeInstruction(w, &decode);
-    HEX8(pc);
-    HEX8(w);
-    INSTOPERAND& o = decode.operand;
-    // n�͌ォ��f�R�[�h����΂킩��
-#define REGCPU(n) \
-    HEX8(reg[n])
-#define REGCPU2(n, m) \
-    REGCPU(n);        \
-    REGCPU(m);
-    // 10�i��
-#define REGFPU(n) \
-    HEX8(*(uint32_t*)reg_cop1_simple[n])
-#define REGFPU2(n, m) \
-    REGFPU(n);        \
-    REGFPU(m)
-#define NONE           \
-    *(uint32_t*)p = 0; \
-    p += 4
-#define NONE2 \
-    NONE;     \
-    NONE
+    const INSTOPERAND& o = decode.operand;
+    const auto fpu = [](const size_t n) {
+        return *(uint32_t*)reg_cop1_simple[n];
+    };
 
     switch (decode.format)
     {
-    case INSTF_NONE:
-        NONE2;
-        break;
-    case INSTF_J:
-    case INSTF_0BRANCH:
-        NONE2;
-        break;
-    case INSTF_LUI:
-        NONE2;
-        break;
     case INSTF_1BRANCH:
     case INSTF_JR:
     case INSTF_ISIGN:
     case INSTF_IUNSIGN:
-        REGCPU(o.i.rs);
-        NONE;
-        break;
+        values[0] = (uint32_t)reg[o.i.rs];
+        return 1;
     case INSTF_2BRANCH:
-        REGCPU2(o.i.rs, o.i.rt);
-        break;
+    case INSTF_R2:
+    case INSTF_R3:
+        values[0] = (uint32_t)reg[o.i.rs];
+        values[1] = (uint32_t)reg[o.i.rt];
+        return 2;
     case INSTF_ADDRW:
-        HEX8(reg[o.i.rs] + (int16_t)o.i.immediate);
-        REGCPU(o.i.rt);
-        break;
+        values[0] = (uint32_t)(reg[o.i.rs] + (int16_t)o.i.immediate);
+        values[1] = (uint32_t)reg[o.i.rt];
+        return 2;
     case INSTF_ADDRR:
-        HEX8(reg[o.i.rs] + (int16_t)o.i.immediate);
-        NONE;
-        break;
+        values[0] = (uint32_t)(reg[o.i.rs] + (int16_t)o.i.immediate);
+        return 1;
     case INSTF_LFW:
-        HEX8(reg[o.lf.base] + (int16_t)o.lf.offset);
-        REGFPU(o.lf.ft);
-        break;
+        values[0] = (uint32_t)(reg[o.lf.base] + (int16_t)o.lf.offset);
+        values[1] = fpu(o.lf.ft);
+        return 2;
     case INSTF_LFR:
-        HEX8(reg[o.lf.base] + (int16_t)o.lf.offset);
-        NONE;
-        break;
+        values[0] = (uint32_t)(reg[o.lf.base] + (int16_t)o.lf.offset);
+        return 1;
     case INSTF_R1:
-        REGCPU(o.r.rd);
-        NONE;
-        break;
-    case INSTF_R2:
-        REGCPU2(o.i.rs, o.i.rt);
-        break;
-    case INSTF_R3:
-        REGCPU2(o.i.rs, o.i.rt);
-        break;
+        values[0] = (uint32_t)reg[o.r.rd];
+        return 1;
     case INSTF_MTC0:
     case INSTF_MTC1:
     case INSTF_SA:
-        REGCPU(o.r.rt);
-        NONE;
-        break;
+        values[0] = (uint32_t)reg[o.r.rt];
+        return 1;
     case INSTF_R2F:
-        REGFPU(o.cf.fs);
-        NONE;
-        break;
+        values[0] = fpu(o.cf.fs);
+        return 1;
     case INSTF_R3F:
     case INSTF_C:
-        REGFPU2(o.cf.fs, o.cf.ft);
-        break;
-    case INSTF_MFC0:
-        NONE2;
-        break;
+        values[0] = fpu(o.cf.fs);
+        values[1] = fpu(o.cf.ft);
+        return 2;
     case INSTF_MFC1:
-        REGFPU(((uint8_t)o.r.rs));
-        NONE;
-        break;
+        values[0] = fpu((uint8_t)o.r.rs);
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Gets the amount of values collect_operands produces for an instruction format.
+ */
+static size_t operand_count(const INSTDECODE& decode)
+{
+    switch (decode.format)
+    {
+    case INSTF_1BRANCH:
+    case INSTF_JR:
+    case INSTF_ISIGN:
+    case INSTF_IUNSIGN:
+    case INSTF_ADDRR:
+    case INSTF_LFR:
+    case INSTF_R1:
+    case INSTF_MTC0:
+    case INSTF_MTC1:
+    case INSTF_SA:
+    case INSTF_R2F:
+    case INSTF_MFC1:
+        return 1;
+    case INSTF_2BRANCH:
+    case INSTF_R2:
+    case INSTF_R3:
+    case INSTF_ADDRW:
+    case INSTF_LFW:
+    case INSTF_R3F:
+    case INSTF_C:
+        return 2;
+    default:
+        return 0;
     }
+}
+
+void log_bin(uint32_t pc, uint32_t w)
+{
+    char*& p = traceLoggingPointer;
+    INSTDECODE decode;
+    uint32_t values[2] = {};
+
+    DecodeInstruction(w, &decode);
+    collect_operands(decode, values);
+
+    // little endian, unused operands are zeroed
+    const uint32_t record[4] = {pc, w, values[0], values[1]};
+    memcpy(p, record, sizeof(record));
+    p += sizeof(record);
+
     write_buf();
-#undef HEX8
-#undef REGCPU
-#undef REGFPU
-#undef REGCPU2
-#undef REGFPU2
 }
 
-void log(uint32_t pc, uint32_t w)
+static void write_varint(char*& p, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *(p++) = (char)(value | 0x80);
+        value >>= 7;
+    }
+    *(p++) = (char)value;
+}
+
+void log_bin_v2(uint32_t pc, uint32_t w)
 {
     char*& p = traceLoggingPointer;
+    INSTDECODE decode;
+    uint32_t values[2];
+
+    DecodeInstruction(w, &decode);
+    const size_t count = collect_operands(decode, values);
+
+    auto& entry = g_v2_dictionary[(w * 0x9E3779B1u) >> (32 - TL_V2_DICTIONARY_BITS)];
+    const bool literal = entry.generation != g_v2_generation || entry.opcode != w;
+
+    const int32_t delta = (int32_t)(pc - g_v2_next_pc);
+    const uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+    write_varint(p, ((uint64_t)zigzag << 2) | (literal << 1) | (delay_slot ? 1 : 0));
+
+    if (literal)
+    {
+        memcpy(p, &w, sizeof(w));
+        p += sizeof(w);
+        entry = {.opcode = w, .index = g_v2_dictionary_size++, .generation = g_v2_generation};
+    }
+    else
+    {
+        write_varint(p, entry.index);
+    }
+
+    memcpy(p, values, count * sizeof(uint32_t));
+    p += count * sizeof(uint32_t);
+
+    g_v2_next_pc = pc + 4;
+    write_buf();
+}
+
+/**
+ * Formats a float like printf's "%f" did, without the locale lookups and format string parsing.
+ */
+static char* format_float(char* p, float value)
+{
+    return std::to_chars(p, p + TL_FLOAT_MAX_LENGTH, (double)value, std::chars_format::fixed, 6).ptr;
+}
+
+/**
+ * The previous sprintf-based float formatter, kept as a baseline for core_tl_benchmark_text.
+ */
+static char* format_float_sprintf(char* p, float value)
+{
+    return p + sprintf_s(p, TL_FLOAT_MAX_LENGTH, "%f", value);
+}
+
+/**
+ * Formats an instruction in the text trace format.
+ * \tparam FormatFloat The function used to format FPU register values.
+ * \param p The output buffer, which must have at least TL_BUFFER_MARGIN bytes left.
+ * \param pc The instruction's address.
+ * \param w The instruction.
+ * \param delay Whether the instruction is executed in a delay slot.
+ * \param values The operand values, as collected by collect_operands.
+ * \return The end of the formatted text.
+ */
+template <char* (*FormatFloat)(char*, float)>
+static char* format_text(char* p, uint32_t pc, uint32_t w, bool delay, const uint32_t values[2])
+{
     INSTDECODE decode;
     const char* const x = "0123456789abcdef";
 #define HEX8(n)                          \
@@ -192,7 +473,7 @@ void log(uint32_t pc, uint32_t w)
     }
     *(p++) = ';';
     INSTOPERAND& o = decode.operand;
-#define REGCPU(n)                                         \
+#define REGCPU(n, v)                                      \
     if ((n) != 0)                                         \
     {                                                     \
         for (const char* l = CPURegisterName[n]; *l; l++) \
@@ -200,32 +481,31 @@ void log(uint32_t pc, uint32_t w)
             *(p++) = *l;                                  \
         }                                                 \
         *(p++) = '=';                                     \
-        HEX8(reg[n]);                                     \
+        HEX8(v);                                          \
     }
 #define REGCPU2(n, m)           \
-    REGCPU(n);                  \
+    REGCPU(n, values[0]);       \
     if ((n) != (m) && (m) != 0) \
     {                           \
         C;                      \
-        REGCPU(m);              \
+        REGCPU(m, values[1]);   \
     }
-    // 10�i��
-#define REGFPU(n)         \
+#define REGFPU(n, v)      \
     *(p++) = 'f';         \
     *(p++) = x[(n) / 10]; \
     *(p++) = x[(n) % 10]; \
     *(p++) = '=';         \
-    p += sprintf_s(p, sizeof(traceLoggingBuf) - (p - traceLoggingBuf), "%f", *reg_cop1_simple[n])
-#define REGFPU2(n, m) \
-    REGFPU(n);        \
-    if ((n) != (m))   \
-    {                 \
-        C;            \
-        REGFPU(m);    \
+    p = FormatFloat(p, std::bit_cast<float>(v))
+#define REGFPU2(n, m)         \
+    REGFPU(n, values[0]);     \
+    if ((n) != (m))           \
+    {                         \
+        C;                    \
+        REGFPU(m, values[1]); \
     }
 #define C *(p++) = ','
 
-    if (delay_slot)
+    if (delay)
     {
         *(p++) = '#';
     }
@@ -242,13 +522,13 @@ void log(uint32_t pc, uint32_t w)
     case INSTF_JR:
     case INSTF_ISIGN:
     case INSTF_IUNSIGN:
-        REGCPU(o.i.rs);
+        REGCPU(o.i.rs, values[0]);
         break;
     case INSTF_2BRANCH:
         REGCPU2(o.i.rs, o.i.rt);
         break;
     case INSTF_ADDRW:
-        REGCPU(o.i.rt);
+        REGCPU(o.i.rt, values[1]);
         if (o.i.rt != 0)
         {
             C;
@@ -256,18 +536,18 @@ void log(uint32_t pc, uint32_t w)
     case INSTF_ADDRR:
         *(p++) = '@';
         *(p++) = '=';
-        HEX8(reg[o.i.rs] + (int16_t)o.i.immediate);
+        HEX8(values[0]);
         break;
     case INSTF_LFW:
-        REGFPU(o.lf.ft);
+        REGFPU(o.lf.ft, values[1]);
         C;
     case INSTF_LFR:
         *(p++) = '@';
         *(p++) = '=';
-        HEX8(reg[o.lf.base] + (int16_t)o.lf.offset);
+        HEX8(values[0]);
         break;
     case INSTF_R1:
-        REGCPU(o.r.rd);
+        REGCPU(o.r.rd, values[0]);
         break;
     case INSTF_R2:
         REGCPU2(o.i.rs, o.i.rt);
@@ -278,10 +558,10 @@ void log(uint32_t pc, uint32_t w)
     case INSTF_MTC0:
     case INSTF_MTC1:
     case INSTF_SA:
-        REGCPU(o.r.rt);
+        REGCPU(o.r.rt, values[0]);
         break;
     case INSTF_R2F:
-        REGFPU(o.cf.fs);
+        REGFPU(o.cf.fs, values[0]);
         break;
     case INSTF_R3F:
     case INSTF_C:
@@ -290,12 +570,12 @@ void log(uint32_t pc, uint32_t w)
     case INSTF_MFC0:
         break;
     case INSTF_MFC1:
-        REGFPU(((uint8_t)o.r.rs));
+        REGFPU(((uint8_t)o.r.rs), values[0]);
         break;
     }
     *(p++) = '\n';
 
-    write_buf();
+    return p;
 #undef HEX8
 #undef REGCPU
 #undef REGFPU
@@ -304,49 +584,423 @@ void log(uint32_t pc, uint32_t w)
 #undef C
 }
 
-void tracelog_log_pure()
+void log(uint32_t pc, uint32_t w)
 {
-    if (!use_binary)
+    INSTDECODE decode;
+    uint32_t values[2];
+
+    DecodeInstruction(w, &decode);
+    collect_operands(decode, values);
+    traceLoggingPointer = format_text<format_float>(traceLoggingPointer, pc, w, delay_slot, values);
+
+    write_buf();
+}
+
+/**
+ * Logs an instruction in the current format.
+ */
+static void log_any(uint32_t pc, uint32_t w)
+{
+    switch (g_format)
     {
-        log(interp_addr, vr_op);
+    case core_tl_format_text:
+        log(pc, w);
+        break;
+    case core_tl_format_binary:
+        log_bin(pc, w);
+        break;
+    case core_tl_format_binary_v2:
+        log_bin_v2(pc, w);
+        break;
     }
-    else
+}
+
+/**
+ * Gets the core_tl_class flags an instruction belongs to.
+ */
+static uint32_t instruction_classes(uint32_t w)
+{
+    INSTDECODE decode;
+    DecodeInstruction(w, &decode);
+
+    switch (decode.format)
+    {
+    case INSTF_ADDRR:
+    case INSTF_ADDRW:
+        return core_tl_class_load_store;
+    case INSTF_LFR:
+    case INSTF_LFW:
+        return core_tl_class_load_store | core_tl_class_cop1;
+    case INSTF_J:
+    case INSTF_JR:
+    case INSTF_0BRANCH:
+    case INSTF_1BRANCH:
+    case INSTF_2BRANCH:
+        return core_tl_class_branch;
+    case INSTF_MFC1:
+    case INSTF_MTC1:
+    case INSTF_R2F:
+    case INSTF_R3F:
+    case INSTF_C:
+        return core_tl_class_cop1;
+    default:
+        return core_tl_class_other;
+    }
+}
+
+static bool in_frame_window()
+{
+    if (g_filter.frame_start == 0 && g_filter.frame_end == SIZE_MAX)
+        return true;
+    return m_current_sample >= 0 && (size_t)m_current_sample >= g_filter.frame_start && (size_t)m_current_sample <= g_filter.frame_end;
+}
+
+bool tracelog_filter_instruction(uint32_t addr, uint32_t w)
+{
+    return g_window_open && addr >= g_filter.pc_start && addr <= g_filter.pc_end && (instruction_classes(w) & g_filter.classes);
+}
+
+void tracelog_on_vi()
+{
+    tracelog_do_work();
+
+    if (!enabled || in_frame_window() == g_window_open)
+        return;
+
+    g_window_open = !g_window_open;
+
+    // The filter is baked into the recompiled blocks, so they have to be rebuilt whenever the window opens or closes.
+    // Branches within a page don't check invalid_code, so the current block is reset too, otherwise a loop in it would keep its old ops.
+    if (interpcore == 0)
     {
-        log_bin(interp_addr, vr_op);
+        core_vr_recompile(UINT32_MAX);
+        reset_current_block();
     }
 }
 
+void tracelog_log_pure()
+{
+    if (!tracelog_filter_instruction(interp_addr, vr_op))
+        return;
+    log_any(interp_addr, vr_op);
+}
+
 void tracelog_log_interp_ops()
 {
     if (enabled)
     {
-        if (!use_binary)
-        {
-            log(PC->addr, PC->src);
-        }
-        else
-        {
-            log_bin(PC->addr, PC->src);
-        }
+        log_any(PC->addr, PC->src);
     }
     PC->s_ops();
 }
 
-void core_tl_start(std::filesystem::path path, bool binary, bool append)
+core_result core_tl_start_ex(std::filesystem::path path, const core_tl_options& options)
 {
-    use_binary = binary;
+    if (enabled)
+    {
+        core_tl_stop();
+    }
+
     _wfopen_s(&log_file, path.wstring().c_str(), L"wb");
+    if (!log_file)
+    {
+        return TL_FileOpenFailed;
+    }
+
+    g_format = options.format;
+    g_compress = options.compress;
+    g_filter = options.filter;
+    g_window_open = in_frame_window();
+
+    if (g_format == core_tl_format_binary_v2)
+    {
+        t_tl_v2_header header{};
+        memcpy(header.magic, TL_V2_MAGIC, sizeof(header.magic));
+        header.version = 2;
+        header.flags = g_compress ? TL_V2_FLAG_DEFLATE : 0;
+        fwrite(&header, sizeof(header), 1, log_file);
+    }
+
+    g_free_buffers.clear();
+    g_pending_buffers.clear();
+    for (size_t i = 0; i < TL_BUFFER_COUNT; ++i)
+    {
+        if (!g_buffers[i])
+            g_buffers[i] = std::make_unique<char[]>(TL_BUFFER_SIZE);
+        g_free_buffers.push_back(i);
+    }
+    traceLoggingBuf = g_buffers[g_free_buffers.back()].get();
+    traceLoggingPointer = traceLoggingBuf;
+    g_free_buffers.pop_back();
+    v2_begin_chunk();
+
+    g_buffers_submitted = 0;
+    g_buffers_stalled = 0;
+    g_buffers_dropped = 0;
+    g_writer_stop = false;
+    g_writer_thread = std::thread(writer_thread);
 
     enabled = true;
     if (interpcore == 0)
     {
         core_vr_recompile(UINT32_MAX);
     }
+    return Res_Ok;
 }
 
-void core_tl_stop()
+void core_tl_start(std::filesystem::path path, bool binary, bool append)
 {
+    core_tl_start_ex(path, core_tl_options{
+                           .format = binary ? core_tl_format_binary : core_tl_format_text,
+                           });
+}
+
+static void stop_impl()
+{
+    if (!enabled)
+    {
+        return;
+    }
+
     enabled = false;
     flush_buf();
+
+    {
+        std::scoped_lock lock(g_writer_mutex);
+        g_writer_stop = true;
+    }
+    g_writer_cv.notify_all();
+    g_writer_thread.join();
+
     fclose(log_file);
+
+    g_core->log_info(std::format(L"Tracelog stopped: {} buffers written, {} stalled, {} dropped", g_buffers_submitted, g_buffers_stalled, g_buffers_dropped));
+}
+
+void tracelog_do_work()
+{
+    std::scoped_lock lock(g_stop_mutex);
+
+    if (!g_stop_requested)
+    {
+        return;
+    }
+
+    stop_impl();
+    g_stop_requested = false;
+    g_stop_cv.notify_all();
+}
+
+void core_tl_stop()
+{
+    std::unique_lock lock(g_stop_mutex);
+
+    if (!core_executing || std::this_thread::get_id() == emu_thread_handle.get_id())
+    {
+        stop_impl();
+        return;
+    }
+
+    // The emu thread might be logging into the current buffer right now, so it has to hand the buffer over itself
+    g_stop_requested = true;
+    while (!g_stop_cv.wait_for(lock, std::chrono::milliseconds(10), [] { return !g_stop_requested; }))
+    {
+        // Once the emu thread has left the execution loop, nothing logs anymore and the stop can be done here
+        if (!core_executing)
+        {
+            stop_impl();
+            g_stop_requested = false;
+            break;
+        }
+    }
+}
+
+static bool read_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for (int32_t shift = 0; p < end && shift < 64; shift += 7)
+    {
+        const uint8_t byte = *(p++);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+core_result core_tl_decode(const std::filesystem::path& path, const std::filesystem::path& out_path)
+{
+    FILE* in = nullptr;
+    _wfopen_s(&in, path.wstring().c_str(), L"rb");
+    if (!in)
+    {
+        return TL_FileOpenFailed;
+    }
+    const std::unique_ptr<FILE, decltype(&fclose)> in_guard(in, &fclose);
+
+    t_tl_v2_header header{};
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, TL_V2_MAGIC, sizeof(header.magic)) || header.version != 2)
+    {
+        return TL_InvalidFormat;
+    }
+
+    FILE* out = nullptr;
+    _wfopen_s(&out, out_path.wstring().c_str(), L"wb");
+    if (!out)
+    {
+        return TL_FileOpenFailed;
+    }
+    const std::unique_ptr<FILE, decltype(&fclose)> out_guard(out, &fclose);
+
+    const std::unique_ptr<libdeflate_decompressor, decltype(&libdeflate_free_decompressor)> decompressor(libdeflate_alloc_decompressor(), &libdeflate_free_decompressor);
+    std::vector<uint8_t> stored;
+    std::vector<uint8_t> chunk;
+    std::vector<uint32_t> dictionary;
+    std::vector<char> text(TL_BUFFER_SIZE);
+
+    t_tl_v2_chunk chunk_header{};
+    while (fread(&chunk_header, sizeof(chunk_header), 1, in) == 1)
+    {
+        if (chunk_header.length > TL_BUFFER_SIZE || chunk_header.stored_length > chunk_header.length)
+        {
+            return TL_InvalidFormat;
+        }
+
+        stored.resize(chunk_header.stored_length);
+        if (fread(stored.data(), 1, stored.size(), in) != stored.size())
+        {
+            return TL_InvalidFormat;
+        }
+
+        if (chunk_header.stored_length == chunk_header.length)
+        {
+            chunk.swap(stored);
+        }
+        else
+        {
+            chunk.resize(chunk_header.length);
+            if (libdeflate_deflate_decompress(decompressor.get(), stored.data(), stored.size(), chunk.data(), chunk.size(), nullptr) != LIBDEFLATE_SUCCESS)
+            {
+                return TL_DecompressionError;
+            }
+        }
+
+        dictionary.clear();
+        uint32_t next_pc = 0;
+        char* t = text.data();
+
+        const uint8_t* p = chunk.data();
+        const uint8_t* const end = p + chunk.size();
+        while (p < end)
+        {
+            uint64_t head;
+            if (!read_varint(p, end, head))
+            {
+                return TL_InvalidFormat;
+            }
+
+            const uint32_t zigzag = (uint32_t)(head >> 2);
+            const uint32_t pc = next_pc + (uint32_t)((zigzag >> 1) ^ (0 - (zigzag & 1)));
+            uint32_t w;
+            if (head & 2)
+            {
+                if (end - p < (ptrdiff_t)sizeof(w))
+                {
+                    return TL_InvalidFormat;
+                }
+                memcpy(&w, p, sizeof(w));
+                p += sizeof(w);
+                dictionary.push_back(w);
+            }
+            else
+            {
+                uint64_t index;
+                if (!read_varint(p, end, index) || index >= dictionary.size())
+                {
+                    return TL_InvalidFormat;
+                }
+                w = dictionary[index];
+            }
+
+            INSTDECODE decode;
+            DecodeInstruction(w, &decode);
+            uint32_t values[2] = {};
+            const size_t count = operand_count(decode);
+            if (end - p < (ptrdiff_t)(count * sizeof(uint32_t)))
+            {
+                return TL_InvalidFormat;
+            }
+            memcpy(values, p, count * sizeof(uint32_t));
+            p += count * sizeof(uint32_t);
+
+            t = format_text<format_float>(t, pc, w, head & 1, values);
+            next_pc = pc + 4;
+
+            if (t >= text.data() + text.size() - TL_BUFFER_MARGIN)
+            {
+                fwrite(text.data(), 1, t - text.data(), out);
+                t = text.data();
+            }
+        }
+
+        fwrite(text.data(), 1, t - text.data(), out);
+    }
+
+    return Res_Ok;
+}
+
+core_tl_benchmark_result core_tl_benchmark_text(size_t count)
+{
+    struct t_instruction {
+        uint32_t w;
+        uint32_t values[2];
+    };
+
+    // An FPU-heavy mix: add.s, mul.s, c.eq.s, lwc1 and swc1 with random registers and values
+    std::mt19937 rng(0);
+    std::vector<t_instruction> instructions(0x1000);
+    for (auto& [w, values] : instructions)
+    {
+        const uint32_t ft = rng() % 32, fs = rng() % 32, fd = rng() % 32;
+        switch (rng() % 5)
+        {
+        case 0:
+            w = 0x46000000 | ft << 16 | fs << 11 | fd << 6 | 0x00;
+            break;
+        case 1:
+            w = 0x46000000 | ft << 16 | fs << 11 | fd << 6 | 0x02;
+            break;
+        case 2:
+            w = 0x46000000 | ft << 16 | fs << 11 | 0x32;
+            break;
+        case 3:
+            w = 0xC4000000 | (rng() % 32) << 21 | ft << 16 | (rng() & 0xFFFF);
+            break;
+        default:
+            w = 0xE4000000 | (rng() % 32) << 21 | ft << 16 | (rng() & 0xFFFF);
+            break;
+        }
+        values[0] = std::bit_cast<uint32_t>(std::uniform_real_distribution<float>(-1000.0f, 1000.0f)(rng));
+        values[1] = std::bit_cast<uint32_t>(std::uniform_real_distribution<float>(-1000.0f, 1000.0f)(rng));
+    }
+
+    const auto buffer = std::make_unique<char[]>(TL_BUFFER_SIZE);
+    const auto measure = [&]<char* (*FormatFloat)(char*, float)>() {
+        char* p = buffer.get();
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto& [w, values] = instructions[i % instructions.size()];
+            p = format_text<FormatFloat>(p, 0x80000000 + (uint32_t)i * 4, w, false, values);
+            if (p >= buffer.get() + TL_BUFFER_SIZE - TL_BUFFER_MARGIN)
+                p = buffer.get();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return count / elapsed.count();
+    };
+
+    return core_tl_benchmark_result{
+    .sprintf_ips = measure.operator()<format_float_sprintf>(),
+    .ips = measure.operator()<format_float>(),
+    };
 }
@@ -15,3 +15,20 @@ void tracelog_log_interp_ops();
  * \brief Logs a pure interp instruction
  */
 void tracelog_log_pure();
+
+/**
+ * \brief Gets whether an instruction passes the tracelog filter and should be logged.
+ * \param addr The instruction's address.
+ * \param w The instruction.
+ */
+bool tracelog_filter_instruction(uint32_t addr, uint32_t w);
+
+/**
+ * \brief Notifies the tracelog about a VI, opening or closing the filter's frame window if needed.
+ */
+void tracelog_on_vi();
+
+/**
+ * \brief Performs work requested from other threads, such as stopping the tracelog. Must be called periodically from the emu thread, including while paused.
+ */
+void tracelog_do_work();
@@ -10,7 +10,9 @@
 #include <cheats.h>
 #include <include/core_api.h>
 #include <memory/pif.h>
+#include <memory/savestate_delta.h>
 #include <memory/savestates.h>
+#include <r4300/movie_container.h>
 #include <r4300/r4300.h>
 #include <r4300/rom.h>
 #include <r4300/timers.h>
@@ -45,7 +47,23 @@ std::optional<size_t> seek_to_frame;
 bool g_seek_pause_at_end;
 std::atomic g_seek_savestate_loading = false;
 std::atomic g_reset_pending = false;
-std::unordered_map<size_t, std::vector<uint8_t>> g_seek_savestates;
+
+// A seek savestate delta can grow up to 1/VCR_SEEK_SAVESTATE_REBASE_DIVISOR of its base's size before the next seek savestate becomes a new base.
+constexpr size_t VCR_SEEK_SAVESTATE_REBASE_DIVISOR = 8;
+
+/**
+ * A seek savestate, stored as a delta against a full base savestate. Bases are shared between seek savestates and released with the last one referencing them.
+ */
+struct t_seek_savestate {
+    std::shared_ptr<const std::vector<uint8_t>> base;
+    std::vector<uint8_t> delta;
+};
+
+// The base which new seek savestates are delta-encoded against. Replaced once deltas against it grow too large.
+std::shared_ptr<const std::vector<uint8_t>> g_seek_savestate_base;
+
+// The seek savestates.
+std::unordered_map<size_t, t_seek_savestate> g_seek_savestates;
 
 bool g_warp_modify_active = false;
 size_t g_warp_modify_first_difference_frame = 0;
@@ -54,6 +72,13 @@ core_vcr_movie_header g_header;
 std::vector<core_buttons> g_movie_inputs;
 std::filesystem::path g_movie_path;
 
+// The path of the m64 last flushed by write_movie, or an empty path if the file's contents are unknown and the next flush must rewrite it fully.
+std::filesystem::path g_flushed_movie_path;
+// The amount of samples in the m64 as of the last flush.
+size_t g_flushed_length_samples = 0;
+// The first sample of g_movie_inputs which might differ from the flushed m64, or SIZE_MAX if none do.
+size_t g_movie_dirty_from = 0;
+
 int32_t m_current_sample = -1;
 int32_t m_current_vi = -1;
 
@@ -64,9 +89,130 @@ std::recursive_mutex vcr_mutex;
 
 bool vcr_is_task_recording(core_vcr_task task);
 
-bool write_movie_impl(const core_vcr_movie_header* hdr, const std::vector<core_buttons>& inputs, const std::filesystem::path& path)
+/**
+ * \brief Stores a seek savestate at the specified frame, encoding it against the current base savestate.
+ * The savestate becomes the new base if the delta would be too large, so deltas stay small as play diverges from the base.
+ */
+void vcr_put_seek_savestate(size_t frame, const std::vector<uint8_t>& buf)
 {
-    g_core->log_info(std::format(L"[VCR] write_movie_impl to {}...", g_movie_path.wstring()));
+    t_seek_savestate st{};
+
+    if (g_seek_savestate_base)
+    {
+        st_delta_encode(*g_seek_savestate_base, buf, st.delta);
+    }
+
+    if (!g_seek_savestate_base || st.delta.size() > g_seek_savestate_base->size() / VCR_SEEK_SAVESTATE_REBASE_DIVISOR)
+    {
+        g_core->log_info(std::format(L"[VCR] Rebasing seek savestates at frame {}", frame));
+        g_seek_savestate_base = std::make_shared<const std::vector<uint8_t>>(buf);
+        st_delta_encode(*g_seek_savestate_base, buf, st.delta);
+    }
+
+    st.base = g_seek_savestate_base;
+    st.delta.shrink_to_fit();
+    g_seek_savestates[frame] = std::move(st);
+}
+
+/**
+ * \brief Reconstructs the seek savestate at the specified frame.
+ * \return Whether the savestate exists and could be reconstructed.
+ */
+bool vcr_get_seek_savestate(size_t frame, std::vector<uint8_t>& buf)
+{
+    if (!g_seek_savestates.contains(frame))
+    {
+        return false;
+    }
+
+    const auto& st = g_seek_savestates[frame];
+    return st_delta_decode(*st.base, st.delta, buf);
+}
+
+/**
+ * \brief Erases the seek savestate at the specified frame. Its base is released once no seek savestates reference it.
+ */
+void vcr_erase_seek_savestate(size_t frame)
+{
+    g_seek_savestates.erase(frame);
+
+    if (g_seek_savestates.empty())
+    {
+        g_seek_savestate_base.reset();
+    }
+}
+
+/**
+ * \brief Gets the amount of memory occupied by the seek savestate store in bytes.
+ */
+size_t vcr_get_seek_savestate_resident_bytes()
+{
+    // There are only a few bases, so a linear search is fine for deduplicating them
+    std::vector<const std::vector<uint8_t>*> bases;
+    size_t bytes = 0;
+
+    if (g_seek_savestate_base)
+    {
+        bases.push_back(g_seek_savestate_base.get());
+        bytes += g_seek_savestate_base->capacity();
+    }
+
+    for (const auto& [_, st] : g_seek_savestates)
+    {
+        if (std::ranges::find(bases, st.base.get()) == bases.end())
+        {
+            bases.push_back(st.base.get());
+            bytes += st.base->capacity();
+        }
+        bytes += st.delta.capacity();
+    }
+    return bytes;
+}
+
+/**
+ * \brief Purges the oldest seek savestates (except the first one) until the store fits the configured count and memory budget.
+ * \param keep A frame whose seek savestate must not be purged.
+ */
+void vcr_trim_seek_savestates(size_t keep)
+{
+    const size_t max_bytes = (size_t)std::max(g_core->cfg->seek_savestate_max_resident_mb, 1) * 1024 * 1024;
+
+    while (g_seek_savestates.size() > (size_t)std::max(g_core->cfg->seek_savestate_max_count, 1) || vcr_get_seek_savestate_resident_bytes() > max_bytes)
+    {
+        size_t oldest = SIZE_MAX;
+        for (const auto& [frame, _] : g_seek_savestates)
+        {
+            if (frame != 0 && frame != keep && frame < oldest)
+            {
+                oldest = frame;
+            }
+        }
+
+        if (oldest == SIZE_MAX)
+        {
+            break;
+        }
+
+        g_core->log_info(std::format(L"[VCR] Seek savestate store too large! Purging seek savestate at frame {}...", oldest));
+        vcr_erase_seek_savestate(oldest);
+        g_core->callbacks.seek_savestate_changed(oldest);
+    }
+}
+
+bool write_movie_container_impl(const core_vcr_movie_header* hdr, const std::vector<core_buttons>& inputs, const std::filesystem::path& path, bool incremental);
+
+/**
+ * \brief Writes a movie to the specified path. Doesn't access any VCR state, so it can be called from background tasks.
+ * \param incremental Whether a compressed movie may only rewrite the chunks which changed since the previous incremental write to the same path.
+ */
+bool write_movie_impl(const core_vcr_movie_header* hdr, const std::vector<core_buttons>& inputs, const std::filesystem::path& path, const bool incremental)
+{
+    if (vcr_container_is_container_path(path))
+    {
+        return write_movie_container_impl(hdr, inputs, path, incremental);
+    }
+
+    g_core->log_info(std::format(L"[VCR] write_movie_impl to {}...", path.wstring()));
 
     FILE* f = nullptr;
     if (fopen_s(&f, path.string().c_str(), "wb+"))
@@ -91,6 +237,82 @@ bool write_movie_impl(const core_vcr_movie_header* hdr, const std::vector<core_b
     return true;
 }
 
+bool write_movie_container_impl(const core_vcr_movie_header* hdr, const std::vector<core_buttons>& inputs, const std::filesystem::path& path, bool incremental)
+{
+    g_core->log_info(std::format(L"[VCR] write_movie_container_impl to {}...", path.wstring()));
+
+    core_vcr_movie_header hdr_copy = *hdr;
+
+    if (!g_core->cfg->vcr_write_extended_format)
+    {
+        hdr_copy.extended_version = 0;
+        memset(&hdr_copy.extended_flags, 0, sizeof(hdr_copy.extended_flags));
+        memset(hdr_copy.extended_data.authorship_tag, 0, sizeof(hdr_copy.extended_data.authorship_tag));
+        memset(&hdr_copy.extended_data, 0, sizeof(hdr_copy.extended_flags));
+    }
+
+    const auto header_bytes = std::span((const uint8_t*)&hdr_copy, sizeof(core_vcr_movie_header));
+    return vcr_container_write(path, header_bytes, std::span(inputs.data(), hdr_copy.length_samples), {}, incremental);
+}
+
+/**
+ * \brief Marks the movie inputs starting at the specified sample as modified since the last flush.
+ */
+static void mark_inputs_dirty(const size_t sample)
+{
+    g_movie_dirty_from = std::min(g_movie_dirty_from, sample);
+}
+
+/**
+ * \brief Forgets the flushed state of the current movie, forcing the next flush to rewrite it fully.
+ */
+static void reset_flushed_state()
+{
+    g_flushed_movie_path.clear();
+    g_flushed_length_samples = 0;
+    g_movie_dirty_from = 0;
+}
+
+/**
+ * \brief Patches the flushed m64 in place: rewrites the header and the inputs modified since the last flush, then truncates the file if the movie got shorter.
+ */
+static bool write_movie_patch_impl()
+{
+    const size_t start = std::min({g_movie_dirty_from, g_flushed_length_samples, (size_t)g_header.length_samples});
+
+    g_core->log_info(std::format(L"[VCR] write_movie_patch_impl from sample {} to {}...", start, g_header.length_samples));
+
+    FILE* f = nullptr;
+    if (fopen_s(&f, g_movie_path.string().c_str(), "rb+"))
+    {
+        return false;
+    }
+
+    core_vcr_movie_header hdr_copy = g_header;
+
+    if (!g_core->cfg->vcr_write_extended_format)
+    {
+        hdr_copy.extended_version = 0;
+        memset(&hdr_copy.extended_flags, 0, sizeof(hdr_copy.extended_flags));
+        memset(hdr_copy.extended_data.authorship_tag, 0, sizeof(hdr_copy.extended_data.authorship_tag));
+        memset(&hdr_copy.extended_data, 0, sizeof(hdr_copy.extended_flags));
+    }
+
+    bool success = fwrite(&hdr_copy, sizeof(core_vcr_movie_header), 1, f) == 1;
+    success &= _fseeki64(f, sizeof(core_vcr_movie_header) + start * sizeof(core_buttons), SEEK_SET) == 0;
+    success &= fwrite(g_movie_inputs.data() + start, sizeof(core_buttons), hdr_copy.length_samples - start, f) == hdr_copy.length_samples - start;
+    success &= fclose(f) == 0;
+
+    if (success && hdr_copy.length_samples < g_flushed_length_samples)
+    {
+        std::error_code ec;
+        std::filesystem::resize_file(g_movie_path, sizeof(core_vcr_movie_header) + (uintmax_t)hdr_copy.length_samples * sizeof(core_buttons), ec);
+        success = !ec;
+    }
+
+    return success;
+}
+
 // Writes the movie header + inputs to current movie_path
 bool write_movie()
 {
@@ -102,15 +324,76 @@ bool write_movie()
 
     g_core->log_info(L"[VCR] Flushing current movie...");
 
-    return write_movie_impl(&g_header, g_movie_inputs, g_movie_path);
+    // Compressed movies track their own flushed state
+    if (vcr_container_is_container_path(g_movie_path))
+    {
+        // Compressed movies only rewrite the chunks which changed since the last flush
+        return write_movie_impl(&g_header, g_movie_inputs, g_movie_path, true);
+    }
+
+    // The m64 layout is fixed, so once the file is known to match what we flushed, only the header and modified inputs need to be written
+    std::error_code ec;
+    const bool can_patch = g_flushed_movie_path == g_movie_path && std::filesystem::file_size(g_movie_path, ec) == sizeof(core_vcr_movie_header) + g_flushed_length_samples * sizeof(core_buttons);
+
+    const bool success = can_patch ? write_movie_patch_impl() : write_movie_impl(&g_header, g_movie_inputs, g_movie_path, true);
+
+    if (!success)
+    {
+        reset_flushed_state();
+        return false;
+    }
+
+    g_flushed_movie_path = g_movie_path;
+    g_flushed_length_samples = g_header.length_samples;
+    g_movie_dirty_from = SIZE_MAX;
+    return true;
+}
+
+/**
+ * \brief Writes a timestamped copy of the current movie to the backups directory.
+ * \param async Whether the file should be written on a background task. The movie is snapshotted before returning either way.
+ */
+/**
+ * \brief Gets a path for a new backup of the current movie. Backups created within the same second get a counter suffix, so no two backups share a path.
+ */
+std::filesystem::path get_backup_path()
+{
+    static std::mutex mutex;
+    static uint64_t last_time = 0;
+    static size_t same_time_count = 0;
+
+    std::scoped_lock lock(mutex);
+
+    const auto now = static_cast<uint64_t>(time(nullptr));
+    same_time_count = now == last_time ? same_time_count + 1 : 0;
+    last_time = now;
+
+    const auto suffix = same_time_count == 0 ? std::string() : std::format("_{}", same_time_count);
+    const auto filename = std::format("{}.{}{}{}", g_movie_path.stem().string(), now, suffix, g_movie_path.extension().string());
+    return g_core->get_backups_directory() / filename;
 }
 
-bool write_backup_impl()
+bool write_backup_impl(const bool async = false)
 {
     g_core->log_info(L"[VCR] Backing up movie...");
-    const auto filename = std::format("{}.{}.m64", g_movie_path.stem().string(), static_cast<uint64_t>(time(nullptr)));
+    const auto path = get_backup_path();
 
-    return write_movie_impl(&g_header, g_movie_inputs, g_core->get_backups_directory() / filename);
+    // The header's length can be ahead of the input buffer while a rerecord replaces it
+    auto header = g_header;
+    header.length_samples = static_cast<uint32_t>(std::min(g_movie_inputs.size(), static_cast<size_t>(g_header.length_samples)));
+
+    if (!async)
+    {
+        return write_movie_impl(&header, g_movie_inputs, path, false);
+    }
+
+    g_core->submit_task([path, header, inputs = std::vector(g_movie_inputs.begin(), g_movie_inputs.begin() + header.length_samples)] {
+        if (!write_movie_impl(&header, inputs, path, false))
+        {
+            g_core->log_error(std::format(L"[VCR] Failed to write backup to {}", path.wstring()));
+        }
+    });
+    return true;
 }
 
 bool is_task_playback(const core_vcr_task task)
@@ -222,7 +505,13 @@ static void set_rom_info(core_vcr_movie_header* header)
     g_core->get_plugin_names(header->video_plugin_name, header->audio_plugin_name, header->input_plugin_name, header->rsp_plugin_name);
 }
 
-static core_result read_movie_header(std::vector<uint8_t> buf, core_vcr_movie_header* header)
+/**
+ * \brief Parses a movie header.
+ * \param buf The movie's data, starting with the header. May only contain the header if sample_count is specified.
+ * \param header The header to fill.
+ * \param sample_count The amount of samples stored in the movie, or an empty optional to derive it from the buffer's size.
+ */
+static core_result read_movie_header(const std::vector<uint8_t>& buf, core_vcr_movie_header* header, std::optional<size_t> sample_count = std::nullopt)
 {
     const core_vcr_movie_header default_hdr{};
     constexpr auto old_header_size = 512;
@@ -305,7 +594,7 @@ static core_result read_movie_header(std::vector<uint8_t> buf, core_vcr_movie_he
         memcpy(new_header.description, buf.data() + 0x300, 256);
 
         // Some movies have a higher length_samples than the actual input buffer size, so we patch the length_samples up and emit a warning
-        const auto actual_sample_count = (buf.size() - sizeof(core_vcr_movie_header)) / sizeof(core_buttons);
+        const auto actual_sample_count = sample_count.value_or((buf.size() - sizeof(core_vcr_movie_header)) / sizeof(core_buttons));
 
         if (new_header.length_samples > actual_sample_count)
         {
@@ -319,24 +608,90 @@ static core_result read_movie_header(std::vector<uint8_t> buf, core_vcr_movie_he
     return Res_Ok;
 }
 
-core_result core_vcr_parse_header(std::filesystem::path path, core_vcr_movie_header* header)
+/**
+ * \brief Reads a movie's header and, optionally, its inputs.
+ * \param path The movie's path. Can be either an m64 or a compressed movie.
+ * \param header The header to fill.
+ * \param inputs The inputs to fill, or nullptr to only read the header.
+ */
+static core_result read_movie_file(const std::filesystem::path& path, core_vcr_movie_header* header, std::vector<core_buttons>* inputs)
 {
-    if (path.extension() != ".m64")
+    if (vcr_container_is_container_path(path))
     {
-        return VCR_InvalidFormat;
+        std::vector<uint8_t> header_buf;
+        size_t sample_count = 0;
+        auto result = vcr_container_read(path, header_buf, inputs, sample_count);
+        if (result != Res_Ok)
+        {
+            return result;
+        }
+
+        result = read_movie_header(header_buf, header, sample_count);
+        if (result != Res_Ok)
+        {
+            return result;
+        }
+
+        if (inputs)
+        {
+            inputs->resize(header->length_samples);
+        }
+        return Res_Ok;
     }
 
-    core_vcr_movie_header new_header = {};
-    new_header.rom_country = -1;
-    strcpy_s(new_header.rom_name, sizeof(new_header.rom_name), "(no ROM)");
+    if (!inputs)
+    {
+        // Only the header is needed, so avoid reading the potentially huge input section
+        std::error_code ec;
+        const auto file_size = std::filesystem::file_size(path, ec);
+        std::ifstream f(path, std::ios::binary);
+        if (ec || !f || file_size == 0)
+        {
+            return VCR_BadFile;
+        }
+
+        std::vector<uint8_t> buf(std::min<uintmax_t>(file_size, sizeof(core_vcr_movie_header)));
+        f.read((char*)buf.data(), buf.size());
 
-    auto buf = read_file_buffer(path);
+        const auto sample_count = file_size > sizeof(core_vcr_movie_header) ? (file_size - sizeof(core_vcr_movie_header)) / sizeof(core_buttons) : 0;
+        return read_movie_header(buf, header, sample_count);
+    }
+
+    const auto buf = read_file_buffer(path);
     if (buf.empty())
     {
         return VCR_BadFile;
     }
 
-    const auto result = read_movie_header(buf, &new_header);
+    const auto result = read_movie_header(buf, header);
+    if (result != Res_Ok)
+    {
+        return result;
+    }
+
+    if (buf.size() < sizeof(core_vcr_movie_header) + sizeof(core_buttons) * header->length_samples)
+    {
+        return VCR_InvalidFormat;
+    }
+
+    inputs->resize(header->length_samples);
+    memcpy(inputs->data(), buf.data() + sizeof(core_vcr_movie_header), sizeof(core_buttons) * header->length_samples);
+
+    return Res_Ok;
+}
+
+core_result core_vcr_parse_header(std::filesystem::path path, core_vcr_movie_header* header)
+{
+    if (path.extension() != ".m64" && !vcr_container_is_container_path(path))
+    {
+        return VCR_InvalidFormat;
+    }
+
+    core_vcr_movie_header new_header = {};
+    new_header.rom_country = -1;
+    strcpy_s(new_header.rom_name, sizeof(new_header.rom_name), "(no ROM)");
+
+    const auto result = read_movie_file(path, &new_header, nullptr);
     *header = new_header;
 
     return result;
@@ -344,23 +699,73 @@ core_result core_vcr_parse_header(std::filesystem::path path, core_vcr_movie_hea
 
 core_result core_vcr_read_movie_inputs(std::filesystem::path path, std::vector<core_buttons>& inputs)
 {
-    core_vcr_movie_header header = {};
-    const auto result = core_vcr_parse_header(path, &header);
-    if (result != Res_Ok)
+    if (path.extension() != ".m64" && !vcr_container_is_container_path(path))
     {
-        return result;
+        return VCR_InvalidFormat;
     }
 
-    auto buf = read_file_buffer(path);
+    core_vcr_movie_header header = {};
+    return read_movie_file(path, &header, &inputs);
+}
+
+core_result core_vcr_convert_movie(const std::filesystem::path& path, const std::filesystem::path& out_path)
+{
+    const bool from_container = vcr_container_is_container_path(path);
+    const bool to_container = vcr_container_is_container_path(out_path);
 
-    if (buf.size() < sizeof(core_vcr_movie_header) + sizeof(core_buttons) * header.length_samples)
+    if (from_container == to_container)
     {
         return VCR_InvalidFormat;
     }
 
-    inputs.resize(header.length_samples);
-    memcpy(inputs.data(), buf.data() + sizeof(core_vcr_movie_header), sizeof(core_buttons) * header.length_samples);
+    if (to_container)
+    {
+        const auto buf = read_file_buffer(path);
+        if (buf.empty())
+        {
+            return VCR_BadFile;
+        }
 
+        core_vcr_movie_header header{};
+        const auto result = read_movie_header(buf, &header);
+        if (result != Res_Ok)
+        {
+            return result;
+        }
+
+        // Everything after the header is kept verbatim, including samples past length_samples and any partial trailing sample
+        const size_t header_size = std::min(buf.size(), sizeof(core_vcr_movie_header));
+        const size_t sample_count = (buf.size() - header_size) / sizeof(core_buttons);
+        const size_t tail_offset = header_size + sample_count * sizeof(core_buttons);
+
+        std::vector<core_buttons> samples(sample_count);
+        memcpy(samples.data(), buf.data() + header_size, sample_count * sizeof(core_buttons));
+
+        if (!vcr_container_write(out_path, std::span(buf.data(), header_size), samples, std::span(buf.data() + tail_offset, buf.size() - tail_offset), false))
+        {
+            return VCR_BadFile;
+        }
+        return Res_Ok;
+    }
+
+    std::vector<uint8_t> header_buf;
+    std::vector<core_buttons> samples;
+    std::vector<uint8_t> tail;
+    size_t sample_count = 0;
+    const auto result = vcr_container_read(path, header_buf, &samples, sample_count, &tail);
+    if (result != Res_Ok)
+    {
+        return result;
+    }
+
+    std::vector<uint8_t> buf = header_buf;
+    buf.insert(buf.end(), (const uint8_t*)samples.data(), (const uint8_t*)(samples.data() + samples.size()));
+    buf.insert(buf.end(), tail.begin(), tail.end());
+
+    if (!write_file_buffer(out_path, buf))
+    {
+        return VCR_BadFile;
+    }
     return Res_Ok;
 }
 
@@ -469,9 +874,15 @@ core_result core_vcr_unfreeze(core_vcr_freeze_info freeze)
             // Before overwriting the input buffer, save a backup
             if (g_core->cfg->vcr_backups)
             {
-                write_backup_impl();
+                write_backup_impl(true);
             }
 
+            const auto overlap = std::min(g_movie_inputs.size(), (size_t)freeze.current_sample);
+            const auto first_difference = std::mismatch(g_movie_inputs.begin(), g_movie_inputs.begin() + overlap, freeze.input_buffer.begin(), [](const core_buttons& a, const core_buttons& b) {
+                return a.value == b.value;
+            });
+            mark_inputs_dirty(first_difference.first - g_movie_inputs.begin());
+
             g_movie_inputs.resize(freeze.current_sample);
             memcpy(g_movie_inputs.data(), freeze.input_buffer.data(), sizeof(core_buttons) * freeze.current_sample);
 
@@ -525,21 +936,6 @@ void vcr_create_n_frame_savestate(size_t frame)
         }
     }
 
-    // If our seek savestate map is getting too large, we'll start purging the oldest ones (but not the first one!!!)
-    if (g_seek_savestates.size() > g_core->cfg->seek_savestate_max_count)
-    {
-        for (int32_t i = 1; i < g_header.length_samples; ++i)
-        {
-            if (g_seek_savestates.contains(i))
-            {
-                g_core->log_info(std::format(L"[VCR] Map too large! Purging seek savestate at frame {}...", i));
-                g_seek_savestates.erase(i);
-                g_core->callbacks.seek_savestate_changed((size_t)i);
-                break;
-            }
-        }
-    }
-
     g_core->log_info(std::format(L"[VCR] Creating seek savestate at frame {}...", frame));
     core_st_do_memory({}, core_st_job_save, [frame](const core_st_callback_info& info, const auto& buf) {
         std::scoped_lock lock(vcr_mutex);
@@ -550,9 +946,12 @@ void vcr_create_n_frame_savestate(size_t frame)
             return;
         }
 
-        g_core->log_info(std::format(L"[VCR] Seek savestate at frame {} of size {} completed", frame, buf.size()));
-        g_seek_savestates[frame] = buf;
+        vcr_put_seek_savestate(frame, buf);
+        g_core->log_info(std::format(L"[VCR] Seek savestate at frame {} of size {} completed (delta size {}, {} bytes resident)", frame, buf.size(), g_seek_savestates[frame].delta.size(), vcr_get_seek_savestate_resident_bytes()));
         g_core->callbacks.seek_savestate_changed((size_t)frame);
+
+        // If our seek savestate store is getting too large, we'll start purging the oldest ones (but not the first one!!!)
+        vcr_trim_seek_savestates(frame);
     },
                       false);
 }
@@ -651,6 +1050,7 @@ void vcr_handle_recording(int32_t index, core_buttons* input)
 
     if (!use_inputs_from_buffer)
     {
+        mark_inputs_dirty(g_movie_inputs.size());
         g_movie_inputs.push_back(*input);
         g_header.length_samples++;
     }
@@ -938,6 +1338,7 @@ core_result core_vcr_start_record(std::filesystem::path path, uint16_t flags, st
     const core_vcr_movie_header default_hdr{};
     memset(&g_header, 0, sizeof(core_vcr_movie_header));
     g_movie_inputs = {};
+    reset_flushed_state();
 
     g_header.magic = mup_magic;
     g_header.version = mup_version;
@@ -1046,15 +1447,8 @@ core_result core_vcr_replace_author_info(const std::filesystem::path& path, cons
     // we skip that step if the values remain identical
 
     // 1. Read movie header
-    const auto buf = read_file_buffer(path);
-
-    if (buf.empty())
-    {
-        return VCR_BadFile;
-    }
-
     core_vcr_movie_header hdr{};
-    auto result = read_movie_header(buf, &hdr);
+    auto result = read_movie_file(path, &hdr, nullptr);
 
     if (result != Res_Ok)
     {
@@ -1080,20 +1474,23 @@ core_result core_vcr_replace_author_info(const std::filesystem::path& path, cons
         return VCR_InvalidFormat;
     }
 
-    fseek(f, 0x222, SEEK_SET);
+    // Compressed movies store the header verbatim after the container header
+    const long base = vcr_container_is_container_path(path) ? VCR_CONTAINER_MOVIE_HEADER_OFFSET : 0;
+
+    fseek(f, base + 0x222, SEEK_SET);
     for (int32_t i = 0; i < 222; ++i)
     {
         fputc(0, f);
     }
-    fseek(f, 0x222, SEEK_SET);
+    fseek(f, base + 0x222, SEEK_SET);
     fwrite(author.data(), 1, author.size(), f);
 
-    fseek(f, 0x300, SEEK_SET);
+    fseek(f, base + 0x300, SEEK_SET);
     for (int32_t i = 0; i < 256; ++i)
     {
         fputc(0, f);
     }
-    fseek(f, 0x300, SEEK_SET);
+    fseek(f, base + 0x300, SEEK_SET);
     fwrite(description.data(), 1, description.size(), f);
 
     fflush(f);
@@ -1125,7 +1522,7 @@ core_result vcr_stop_record()
     {
         g_task = task_idle;
         g_core->log_info(L"[VCR] Removing files (nothing recorded)");
-        _unlink(std::filesystem::path(g_movie_path).replace_extension(".m64").string().c_str());
+        _unlink(std::filesystem::path(g_movie_path).replace_extension(vcr_container_is_container_path(g_movie_path) ? ".m64z" : ".m64").string().c_str());
         _unlink(std::filesystem::path(g_movie_path).replace_extension(".st").string().c_str());
     }
 
@@ -1178,11 +1575,13 @@ core_result core_vcr_start_playback(std::filesystem::path path)
 {
     std::unique_lock lock(vcr_mutex);
 
-    auto movie_buf = read_file_buffer(path);
+    core_vcr_movie_header header{};
+    std::vector<core_buttons> movie_inputs{};
+    const auto result = read_movie_file(path, &header, &movie_inputs);
 
-    if (movie_buf.empty())
+    if (result == VCR_BadFile)
     {
-        return VCR_BadFile;
+        return result;
     }
 
     if (!core_executing)
@@ -1191,27 +1590,21 @@ core_result core_vcr_start_playback(std::filesystem::path path)
         // If we kept the lock, the core would become permanently stuck waiting for it to be released in on_controller_poll.
         lock.unlock();
 
-        const auto result = core_vr_start_rom(path);
+        const auto start_result = core_vr_start_rom(path);
 
-        if (result != Res_Ok)
+        if (start_result != Res_Ok)
         {
-            return result;
+            return start_result;
         }
 
         lock.lock();
     }
 
-    core_vcr_movie_header header{};
-    const auto result = read_movie_header(movie_buf, &header);
     if (result != Res_Ok)
     {
         return result;
     }
 
-    std::vector<core_buttons> movie_inputs{};
-    movie_inputs.resize(header.length_samples);
-    memcpy(movie_inputs.data(), movie_buf.data() + sizeof(core_vcr_movie_header), sizeof(core_buttons) * header.length_samples);
-
     for (auto& [Present, RawData, Plugin] : g_core->controls)
     {
         if (!Present || !RawData)
@@ -1315,8 +1708,9 @@ core_result core_vcr_start_playback(std::filesystem::path path)
     m_current_sample = 0;
     m_current_vi = 0;
     g_movie_path = path;
-    g_movie_inputs = movie_inputs;
+    g_movie_inputs = std::move(movie_inputs);
     g_header = header;
+    reset_flushed_state();
 
     if (header.startFlags & MOVIE_START_FROM_SNAPSHOT)
     {
@@ -1418,6 +1812,34 @@ size_t vcr_find_closest_savestate_before_frame(size_t frame)
     return lowest_distance_frame;
 }
 
+/**
+ * \brief Reconstructs the closest seek savestate before the specified frame. Seek savestates which can't be reconstructed are erased and the next closest one is tried instead.
+ * \param frame The frame.
+ * \param buf The buffer to fill with the savestate.
+ * \return The frame of the reconstructed savestate, or std::nullopt if no seek savestate before the frame could be reconstructed.
+ */
+static std::optional<size_t> vcr_get_closest_seek_savestate(size_t frame, std::vector<uint8_t>& buf)
+{
+    while (true)
+    {
+        const auto closest_key = vcr_find_closest_savestate_before_frame(frame);
+
+        if (vcr_get_seek_savestate(closest_key, buf))
+        {
+            return closest_key;
+        }
+
+        if (!g_seek_savestates.contains(closest_key))
+        {
+            return std::nullopt;
+        }
+
+        g_core->log_warn(std::format(L"[VCR] Seek savestate at frame {} couldn't be reconstructed, erasing it...", closest_key));
+        vcr_erase_seek_savestate(closest_key);
+        g_core->callbacks.seek_savestate_changed(closest_key);
+    }
+}
+
 core_result vcr_begin_seek_impl(std::wstring str, bool pause_at_end, bool resume, bool warp_modify)
 {
     std::scoped_lock lock(vcr_mutex);
@@ -1489,28 +1911,35 @@ core_result vcr_begin_seek_impl(std::wstring str, bool pause_at_end, bool resume
             g_core->cfg->vcr_readonly = true;
             g_core->callbacks.readonly_changed((bool)g_core->cfg->vcr_readonly);
 
-            const auto closest_key = vcr_find_closest_savestate_before_frame(frame);
+            std::vector<uint8_t> st_buf;
+            const auto closest_key = vcr_get_closest_seek_savestate(frame, st_buf);
 
-            g_core->log_info(std::format(L"[VCR] Seeking during playback to frame {}, loading closest savestate at {}...", frame, closest_key));
-            g_seek_savestate_loading = true;
-
-            // NOTE: This needs to go through AsyncExecutor (despite us already being on a worker thread) or it will cause a deadlock.
-            g_core->submit_task([=] {
-                core_st_do_memory(g_seek_savestates[closest_key], core_st_job_load, [=](const core_st_callback_info& info, auto buf) {
-                    if (info.result != Res_Ok)
-                    {
-                        g_core->show_dialog(L"Failed to load seek savestate for seek operation.", L"VCR", fsvc_error);
+            // Without a usable seek savestate, fall back to replaying the movie from the start
+            if (closest_key.has_value())
+            {
+                g_core->log_info(std::format(L"[VCR] Seeking during playback to frame {}, loading closest savestate at {}...", frame, closest_key.value()));
+                g_seek_savestate_loading = true;
+
+                // NOTE: This needs to go through AsyncExecutor (despite us already being on a worker thread) or it will cause a deadlock.
+                g_core->submit_task([=] {
+                    core_st_do_memory(st_buf, core_st_job_load, [=](const core_st_callback_info& info, auto buf) {
+                        if (info.result != Res_Ok)
+                        {
+                            g_core->show_dialog(L"Failed to load seek savestate for seek operation.", L"VCR", fsvc_error);
+                            g_seek_savestate_loading = false;
+                            core_vcr_stop_seek();
+                        }
+
+                        g_core->log_info(std::format(L"[VCR] Seek savestate at frame {} loaded!", closest_key.value()));
                         g_seek_savestate_loading = false;
-                        core_vcr_stop_seek();
-                    }
+                    },
+                                      false);
+                });
 
-                    g_core->log_info(std::format(L"[VCR] Seek savestate at frame {} loaded!", closest_key));
-                    g_seek_savestate_loading = false;
-                },
-                                  false);
-            });
+                return Res_Ok;
+            }
 
-            return Res_Ok;
+            g_core->log_warn(std::format(L"[VCR] No usable seek savestate before frame {}, replaying from the start...", frame));
         }
 
         g_core->log_trace(L"[VCR] vcr_begin_seek_impl: playback, slow path");
@@ -1551,19 +1980,29 @@ core_result vcr_begin_seek_impl(std::wstring str, bool pause_at_end, bool resume
             for (const auto sample : to_erase)
             {
                 g_core->log_info(std::format(L"[VCR] Erasing now-invalidated seek savestate at frame {}...", sample));
-                g_seek_savestates.erase(sample);
+                vcr_erase_seek_savestate(sample);
                 g_core->callbacks.seek_savestate_changed((size_t)sample);
             }
         }
 
-        const auto closest_key = vcr_find_closest_savestate_before_frame(target_sample);
+        std::vector<uint8_t> st_buf;
+        const auto closest_key = vcr_get_closest_seek_savestate(target_sample, st_buf);
 
-        g_core->log_info(std::format(L"[VCR] Seeking backwards during recording to frame {}, loading closest savestate at {}...", target_sample, closest_key));
+        // Unlike playback, recording has no full replay to fall back to, so the seek fails
+        if (!closest_key.has_value())
+        {
+            g_core->log_error(std::format(L"[VCR] No usable seek savestate before frame {}", target_sample));
+            seek_to_frame.reset();
+            g_core->callbacks.seek_status_changed();
+            return VCR_SeekSavestateLoadFailed;
+        }
+
+        g_core->log_info(std::format(L"[VCR] Seeking backwards during recording to frame {}, loading closest savestate at {}...", target_sample, closest_key.value()));
         g_seek_savestate_loading = true;
 
         // NOTE: This needs to go through AsyncExecutor (despite us already being on a worker thread) or it will cause a deadlock.
         g_core->submit_task([=] {
-            core_st_do_memory(g_seek_savestates[closest_key], core_st_job_load, [=](const core_st_callback_info& info, auto buf) {
+            core_st_do_memory(st_buf, core_st_job_load, [=](const core_st_callback_info& info, auto buf) {
                 if (info.result != Res_Ok)
                 {
                     g_core->show_dialog(L"Failed to load seek savestate for seek operation.", L"VCR", fsvc_error);
@@ -1571,7 +2010,7 @@ core_result vcr_begin_seek_impl(std::wstring str, bool pause_at_end, bool resume
                     core_vcr_stop_seek();
                 }
 
-                g_core->log_info(std::format(L"[VCR] Seek savestate at frame {} loaded!", closest_key));
+                g_core->log_info(std::format(L"[VCR] Seek savestate at frame {} loaded!", closest_key.value()));
                 g_seek_savestate_loading = false;
             },
                               false);
@@ -1663,6 +2102,7 @@ static void vcr_clear_seek_savestates()
     }
 
     g_seek_savestates.clear();
+    g_seek_savestate_base.reset();
 
     for (const auto frame : prev_seek_savestate_keys)
     {
@@ -1797,6 +2237,7 @@ core_result core_vcr_begin_warp_modify(const std::vector<core_buttons>& inputs)
     {
         g_core->log_info(std::format(L"[VCR] First different frame is in the future (current sample: {}, first differenece: {}), copying inputs with no seek...", m_current_sample, g_warp_modify_first_difference_frame));
 
+        mark_inputs_dirty(g_warp_modify_first_difference_frame);
         g_movie_inputs = inputs;
         g_header.length_samples = g_movie_inputs.size();
 
@@ -1820,6 +2261,7 @@ core_result core_vcr_begin_warp_modify(const std::vector<core_buttons>& inputs)
 
     g_warp_modify_active = true;
 
+    mark_inputs_dirty(g_warp_modify_first_difference_frame);
     g_movie_inputs = inputs;
     g_header.length_samples = g_movie_inputs.size();
     g_core->log_info(std::format(L"[VCR] Warp modify started at frame {}", m_current_sample));
@@ -1855,6 +2297,12 @@ bool core_vcr_has_seek_savestate_at_frame(const size_t frame)
     return g_seek_savestates.contains(frame);
 }
 
+size_t core_vcr_get_seek_savestate_resident_bytes()
+{
+    std::scoped_lock lock(vcr_mutex);
+    return vcr_get_seek_savestate_resident_bytes();
+}
+
 void vcr_on_vi()
 {
     m_current_vi++;
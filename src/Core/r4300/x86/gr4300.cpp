@@ -14,6 +14,7 @@
 #include <r4300/recomph.h>
 #include <r4300/x86/assemble.h>
 #include <r4300/x86/regcache.h>
+#include <alloc.h>
 
 extern uint32_t src; // recomp.c
 
@@ -205,10 +206,7 @@ void genj_out()
 
     mov_m32_imm32((void*)(&last_addr), naddr);
     gencheck_interrupt_out(naddr);
-    mov_m32_imm32(&jump_to_address, naddr);
-    mov_m32_imm32((uint32_t*)(&PC), (uint32_t)(dst + 1));
-    mov_reg32_imm32(EAX, (uint32_t)jump_to_func);
-    call_reg32(EAX);
+    genlink_jump_out(naddr);
 #endif
 }
 
@@ -295,10 +293,7 @@ void genjal_out()
 
     mov_m32_imm32((void*)(&last_addr), naddr);
     gencheck_interrupt_out(naddr);
-    mov_m32_imm32(&jump_to_address, naddr);
-    mov_m32_imm32((uint32_t*)(&PC), (uint32_t)(dst + 1));
-    mov_reg32_imm32(EAX, (uint32_t)jump_to_func);
-    call_reg32(EAX);
+    genlink_jump_out(naddr);
 #endif
 }
 
@@ -444,10 +439,7 @@ void gentest_out()
     temp = code_length;
     mov_m32_imm32((void*)(&last_addr), dst->addr + (dst - 1)->f.i.immediate * 4);
     gencheck_interrupt_out(dst->addr + (dst - 1)->f.i.immediate * 4);
-    mov_m32_imm32(&jump_to_address, dst->addr + (dst - 1)->f.i.immediate * 4);
-    mov_m32_imm32((uint32_t*)(&PC), (uint32_t)(dst + 1));
-    mov_reg32_imm32(EAX, (uint32_t)jump_to_func);
-    call_reg32(EAX);
+    genlink_jump_out(dst->addr + (dst - 1)->f.i.immediate * 4);
 
     temp2 = code_length;
     code_length = temp - 4;
@@ -1019,10 +1011,7 @@ void gentestl_out()
     gendelayslot();
     mov_m32_imm32((void*)(&last_addr), dst->addr + (dst - 1)->f.i.immediate * 4);
     gencheck_interrupt_out(dst->addr + (dst - 1)->f.i.immediate * 4);
-    mov_m32_imm32(&jump_to_address, dst->addr + (dst - 1)->f.i.immediate * 4);
-    mov_m32_imm32((uint32_t*)(&PC), (uint32_t)(dst + 1));
-    mov_reg32_imm32(EAX, (uint32_t)jump_to_func);
-    call_reg32(EAX);
+    genlink_jump_out(dst->addr + (dst - 1)->f.i.immediate * 4);
 
     temp2 = code_length;
     code_length = temp - 4;
@@ -1740,7 +1729,7 @@ inline void put8gr(unsigned char octet)
     if (code_length == max_code_length)
     {
         max_code_length += JUMP_TABLE_SIZE;
-        *inst_pointer = (unsigned char*)realloc(*inst_pointer, max_code_length);
+        *inst_pointer = (unsigned char*)realloc_exec(*inst_pointer, code_length, max_code_length);
     }
 }
 
@@ -9,6 +9,8 @@
 #include <r4300/r4300.h>
 #include <r4300/recomp.h>
 #include <r4300/recomph.h>
+#include <r4300/ops.h>
+#include <r4300/x86/assemble.h>
 
 // NOTE: dynarec isn't compatible with the game debugger
 
@@ -20,6 +22,171 @@ void dyna_jump()
         *return_address = (uint32_t)(actual->code + PC->local_addr);
 }
 
+// Linkable block exit layout:
+//  head: jmp short tail (EB xx), patched to fall through into the link area once linked
+//  link area: direct jump to the target block, guarded by the target's invalid_code flags
+//  tail: the regular exit through dyna_link_jump
+constexpr uint8_t LINK_HEAD_SIZE = 2;
+constexpr uint8_t LINK_AREA_SIZE = 54;
+constexpr uint8_t LINK_TAIL_SIZE = 27;
+constexpr uint8_t LINK_EXIT_SIZE = LINK_HEAD_SIZE + LINK_AREA_SIZE + LINK_TAIL_SIZE;
+
+/**
+ * A linked block exit.
+ */
+struct t_block_link {
+    // The block containing the exit.
+    precomp_block* source;
+    // The offset of the exit in the source block's code.
+    uint32_t offset;
+};
+
+// Linked exits, keyed by the block they jump to.
+static std::unordered_map<precomp_block*, std::vector<t_block_link>> g_incoming_links;
+
+// Blocks which have been linked to, keyed by the block containing the exit. May contain duplicates.
+static std::unordered_map<precomp_block*, std::vector<precomp_block*>> g_outgoing_links;
+
+void genlink_jump_out(uint32_t addr)
+{
+    const auto start = code_length;
+
+    jmp_imm_short(LINK_AREA_SIZE);
+    for (size_t i = 0; i < LINK_AREA_SIZE; ++i)
+        put8(0xCC);
+
+    mov_m32_imm32(&jump_to_address, addr);
+    mov_m32_imm32((uint32_t*)(&PC), (uint32_t)(dst + 1));
+    mov_reg32_imm32(EAX, (uint32_t)dyna_link_jump);
+    call_reg32(EAX);
+
+    assert(code_length - start == LINK_EXIT_SIZE);
+}
+
+/**
+ * Writes the direct jump to the current block and instruction into a linkable exit's link area.
+ */
+static void write_link(uint8_t* exit, const uint32_t target_addr)
+{
+    uint8_t* p = exit + LINK_HEAD_SIZE;
+    uint8_t* const tail = exit + LINK_HEAD_SIZE + LINK_AREA_SIZE;
+
+    const auto put8_at = [&](const uint8_t value) {
+        *p++ = value;
+    };
+    const auto put32_at = [&](const uint32_t value) {
+        memcpy(p, &value, sizeof(value));
+        p += sizeof(value);
+    };
+    const auto jne_tail = [&] {
+        put8_at(0x75);
+        put8_at((uint8_t)(tail - (p + 1)));
+    };
+
+    // The target is only valid as long as neither of its kseg0/kseg1 aliases has been invalidated
+    put8_at(0x80); // cmp byte [invalid_code + page], 0
+    put8_at(0x3D);
+    put32_at((uint32_t)&invalid_code[target_addr >> 12]);
+    put8_at(0);
+    jne_tail();
+    put8_at(0x80);
+    put8_at(0x3D);
+    put32_at((uint32_t)&invalid_code[(target_addr ^ 0x20000000) >> 12]);
+    put8_at(0);
+    jne_tail();
+
+    put8_at(0x83); // cmp dword [skip_jump], 0
+    put8_at(0x3D);
+    put32_at((uint32_t)&skip_jump);
+    put8_at(0);
+    jne_tail();
+
+    put8_at(0xC7); // mov dword [actual], imm32
+    put8_at(0x05);
+    put32_at((uint32_t)&actual);
+    put32_at((uint32_t)actual);
+    put8_at(0xC7); // mov dword [PC], imm32
+    put8_at(0x05);
+    put32_at((uint32_t)&PC);
+    put32_at((uint32_t)PC);
+    put8_at(0xB8); // mov eax, imm32
+    put32_at((uint32_t)(actual->code + PC->local_addr));
+    put8_at(0xFF); // jmp eax
+    put8_at(0xE0);
+
+    assert(p == tail);
+
+    // Enter the link area instead of skipping it
+    exit[1] = 0;
+}
+
+void dyna_link_jump()
+{
+    precomp_block* const source = actual;
+    const uint32_t ret = *return_address;
+    const uint32_t target_addr = jump_to_address;
+
+    jump_to_func();
+
+    // jump_to_func didn't redirect us, so there's nothing to link to
+    if (*return_address == ret)
+        return;
+
+    // Only link to code which is fully resolved and doesn't depend on the TLB
+    if (target_addr < 0x80000000 || target_addr >= 0xC0000000 || PC->reg_cache_infos.need_map || PC->ops == NOTCOMPILED || PC->ops == NOTCOMPILED2 || core_vr_is_tracelog_active())
+        return;
+
+    const auto exit = (uint8_t*)(ret - LINK_EXIT_SIZE);
+    if (!source || !source->code || exit < source->code || exit + LINK_EXIT_SIZE > source->code + source->code_length || exit[0] != 0xEB || exit[1] != LINK_AREA_SIZE)
+        return;
+
+    write_link(exit, target_addr);
+
+    g_incoming_links[actual].push_back(t_block_link{
+    .source = source,
+    .offset = (uint32_t)(exit - source->code),
+    });
+    g_outgoing_links[source].push_back(actual);
+}
+
+void dyna_unlink_block(precomp_block* block, bool discard_exits)
+{
+    // Restore every exit which jumps to this block
+    if (const auto it = g_incoming_links.find(block); it != g_incoming_links.end())
+    {
+        for (const auto& link : it->second)
+        {
+            if (link.source->code)
+                link.source->code[link.offset + 1] = LINK_AREA_SIZE;
+
+            auto& targets = g_outgoing_links[link.source];
+            if (const auto target = std::ranges::find(targets, block); target != targets.end())
+                targets.erase(target);
+        }
+        g_incoming_links.erase(it);
+    }
+
+    // Forget the exits contained in this block, since its code is about to be rewritten
+    if (discard_exits)
+    {
+        if (const auto it = g_outgoing_links.find(block); it != g_outgoing_links.end())
+        {
+            for (const auto target : it->second)
+            {
+                if (const auto incoming = g_incoming_links.find(target); incoming != g_incoming_links.end())
+                    std::erase_if(incoming->second, [&](const t_block_link& link) { return link.source == block; });
+            }
+            g_outgoing_links.erase(it);
+        }
+    }
+}
+
+void dyna_clear_links()
+{
+    g_incoming_links.clear();
+    g_outgoing_links.clear();
+}
+
 jmp_buf g_jmp_state;
 
 void dyna_start(void (*code)())
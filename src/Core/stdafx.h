@@ -6,11 +6,16 @@
 
 #include <algorithm>
 #include <any>
+#include <array>
 #include <atomic>
+#include <bit>
 #include <cassert>
 #include <cctype>
 #include <cfloat>
+#include <charconv>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <csetjmp>
 #include <cstdarg>
 #include <cstdint>
@@ -26,6 +31,7 @@
 #include <mutex>
 #include <numeric>
 #include <queue>
+#include <random>
 #include <span>
 #include <stack>
 #include <string>
@@ -8,6 +8,7 @@
 #include <Config.h>
 #include <Messenger.h>
 #include <ini.h>
+#include <components/CLI.h>
 
 static t_config get_default_config();
 
@@ -43,6 +44,7 @@ const std::unordered_map<std::string, size_t> DIALOG_SILENT_MODE_CHOICES = {
 {VIEW_DLG_UPDATE_DIALOG, 2},
 {VIEW_DLG_PLUGIN_LOAD_ERROR, 0},
 {VIEW_DLG_RAMSTART, 0},
+{VIEW_DLG_TRACELOG_FORMAT, 0},
 };
 
 const t_config g_default_config = get_default_config();
@@ -791,6 +793,7 @@ static void handle_config_ini(const bool is_reading, mINI::INIStructure& ini)
     HANDLE_P_VALUE(is_recent_scripts_frozen)
     HANDLE_P_VALUE(core.seek_savestate_interval)
     HANDLE_P_VALUE(core.seek_savestate_max_count)
+    HANDLE_P_VALUE(core.seek_savestate_max_resident_mb)
     HANDLE_P_VALUE(piano_roll_constrain_edit_to_column)
     HANDLE_P_VALUE(piano_roll_undo_stack_size)
     HANDLE_P_VALUE(piano_roll_keep_selection_visible)
@@ -801,6 +804,7 @@ static void handle_config_ini(const bool is_reading, mINI::INIStructure& ini)
     HANDLE_P_VALUE(core.float_exception_emulation)
     HANDLE_P_VALUE(core.is_audio_delay_enabled)
     HANDLE_P_VALUE(core.is_compiled_jump_enabled)
+    HANDLE_P_VALUE(core.save_media_backend)
     HANDLE_VALUE(selected_video_plugin)
     HANDLE_VALUE(selected_audio_plugin)
     HANDLE_VALUE(selected_input_plugin)
@@ -1057,6 +1061,10 @@ void Config::save()
 
     config_patch(g_config);
 
+    // Session-only overrides mustn't end up in the config file
+    const auto session_config = g_config;
+    CLI::revert_overrides(g_config);
+
     std::remove(get_config_path().string().c_str());
 
     mINI::INIFile file(get_config_path().string());
@@ -1065,6 +1073,8 @@ void Config::save()
     handle_config_ini(false, ini);
 
     file.write(ini, true);
+
+    g_config = session_config;
 }
 
 void Config::load()
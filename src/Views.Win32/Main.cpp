@@ -277,6 +277,20 @@ bool show_error_dialog_for_result(const core_result result, void* hwnd)
         module = L"Core";
         error = L"Failed to open streams to core files.\r\nVerify that Mupen is allowed disk access.";
         break;
+#pragma endregion
+#pragma region Tracelog
+    case TL_FileOpenFailed:
+        module = L"Tracelog";
+        error = L"The trace file couldn't be opened.";
+        break;
+    case TL_InvalidFormat:
+        module = L"Tracelog";
+        error = L"The trace file isn't a compact binary trace.";
+        break;
+    case TL_DecompressionError:
+        module = L"Tracelog";
+        error = L"The trace file is corrupted.";
+        break;
 #pragma endregion
     default:
         module = L"Unknown";
@@ -442,6 +456,11 @@ std::filesystem::path get_backups_directory()
     return g_config.backups_directory;
 }
 
+std::filesystem::path get_cache_directory()
+{
+    return g_app_path / L"cache\\";
+}
+
 std::filesystem::path get_summercart_path()
 {
     return get_saves_directory() / "card.vhd";
@@ -973,7 +992,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
                     show_error_dialog_for_result(result);
                 });
             }
-            else if (extension == ".m64")
+            else if (extension == ".m64" || extension == ".m64z")
             {
                 g_config.core.vcr_readonly = true;
                 Messenger::broadcast(Messenger::Message::ReadonlyChanged, (bool)g_config.core.vcr_readonly);
@@ -1417,6 +1436,12 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
                     DialogService::show_dialog(std::format(L"100,000,000 atreset callback invocations took {}ms", timer.momentary_ms()).c_str(), L"Benchmark Lua Callback", fsvc_information);
                 }
                 break;
+            case IDM_BENCHMARK_TRACELOG:
+                {
+                    const auto result = core_tl_benchmark_text(10'000'000);
+                    DialogService::show_dialog(std::format(L"Text tracelog, FPU-heavy mix:\nsprintf: {:.0f} instructions/s\nto_chars: {:.0f} instructions/s", result.sprintf_ips, result.ips).c_str(), L"Benchmark Tracelog", fsvc_information);
+                }
+                break;
             case IDM_TRACELOG:
                 {
                     if (core_vr_is_tracelog_active())
@@ -1433,12 +1458,47 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT Message, WPARAM wParam, LPARAM lParam)
                         break;
                     }
 
-                    auto result = MessageBox(g_main_hwnd, L"Should the trace log be generated in a binary format?", L"Trace Logger", MB_YESNO | MB_ICONQUESTION | MB_DEFBUTTON1);
+                    const auto format = DialogService::show_multiple_choice_dialog(
+                    VIEW_DLG_TRACELOG_FORMAT,
+                    {L"Text", L"Binary", L"Compact Binary", L"Cancel"},
+                    L"Which format should the trace log be generated in?\r\nCompact binary traces are compressed and can be converted to text via Utilities > Decode Trace Log.",
+                    L"Trace Logger",
+                    fsvc_information);
+
+                    if (format == 3)
+                    {
+                        break;
+                    }
 
-                    core_tl_start(path, result == IDYES, false);
+                    const auto result = core_tl_start_ex(path, core_tl_options{
+                                                               .format = (core_tl_format)format,
+                                                               .compress = format == core_tl_format_binary_v2,
+                                                               });
+                    if (show_error_dialog_for_result(result))
+                    {
+                        break;
+                    }
                     ModifyMenu(g_main_menu, IDM_TRACELOG, MF_BYCOMMAND | MF_STRING, IDM_TRACELOG, L"Stop &Trace Logger");
                 }
                 break;
+            case IDM_DECODE_TRACELOG:
+                {
+                    const auto path = FilePicker::show_open_dialog(L"o_tracelog", g_main_hwnd, L"*.log;*.bin");
+                    if (path.empty())
+                    {
+                        break;
+                    }
+
+                    const auto out_path = FilePicker::show_save_dialog(L"s_tracelog_decoded", g_main_hwnd, L"*.log;*.txt");
+                    if (out_path.empty())
+                    {
+                        break;
+                    }
+
+                    const auto result = core_tl_decode(path, out_path);
+                    show_error_dialog_for_result(result);
+                }
+                break;
             case IDM_CLOSE_ROM:
                 if (!confirm_user_exit())
                     break;
@@ -2120,13 +2180,13 @@ static void CALLBACK invalidate_callback(UINT, UINT, DWORD_PTR, DWORD_PTR, DWORD
     // We throttle FPS and VI/s visual updates to 1 per second, so no unstable values are displayed
     if (time - last_statusbar_update > std::chrono::seconds(1))
     {
-        g_core.g_frame_deltas_mutex.lock();
-        auto fps = get_rate_per_second_from_deltas(g_core.g_frame_deltas);
-        g_core.g_frame_deltas_mutex.unlock();
+        core_timer_deltas deltas{};
+
+        core_vr_get_frame_deltas(deltas);
+        auto fps = get_rate_per_second_from_deltas(deltas);
 
-        g_core.g_vi_deltas_mutex.lock();
-        auto vis = get_rate_per_second_from_deltas(g_core.g_vi_deltas);
-        g_core.g_vi_deltas_mutex.unlock();
+        core_vr_get_vi_deltas(deltas);
+        auto vis = get_rate_per_second_from_deltas(deltas);
 
         Statusbar::post(std::format(L"FPS: {:.1f}", fps), Statusbar::Section::FPS);
         Statusbar::post(std::format(L"VI/s: {:.1f}", vis), Statusbar::Section::VIs);
@@ -2306,6 +2366,7 @@ static core_result init_core()
     };
     g_core.get_saves_directory = get_saves_directory;
     g_core.get_backups_directory = get_backups_directory;
+    g_core.get_cache_directory = get_cache_directory;
     g_core.get_summercart_path = get_summercart_path;
     g_core.show_multiple_choice_dialog = [](const std::string& id, const std::vector<std::wstring>& choices, const wchar_t* str, const wchar_t* title, core_dialog_type type) {
         return DialogService::show_multiple_choice_dialog(id, choices, str, title, type);
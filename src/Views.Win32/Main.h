@@ -139,5 +139,6 @@ std::filesystem::path get_st_with_slot_path(size_t slot);
 #define VIEW_DLG_UPDATE_DIALOG "VIEW_DLG_UPDATE_DIALOG"
 #define VIEW_DLG_PLUGIN_LOAD_ERROR "VIEW_DLG_PLUGIN_LOAD_ERROR"
 #define VIEW_DLG_RAMSTART "VIEW_DLG_RAMSTART"
+#define VIEW_DLG_TRACELOG_FORMAT "VIEW_DLG_TRACELOG_FORMAT"
 
 #pragma endregion
@@ -5,12 +5,77 @@
  */
 
 #include "stdafx.h"
+#include <future>
+#include <Config.h>
 #include <json.hpp>
 #include <components/Benchmark.h>
 
+// The maximum time to wait for a single savestate operation before giving up.
+constexpr auto ST_TIMEOUT = std::chrono::seconds(5);
+
 static size_t frames{};
 static std::chrono::time_point<std::chrono::high_resolution_clock> start_time;
 
+static Benchmark::t_latency compute_latency(std::vector<double> samples)
+{
+    if (samples.empty())
+    {
+        return {};
+    }
+
+    std::ranges::sort(samples);
+
+    const auto percentile = [&](const double p) {
+        const auto index = std::min(samples.size() - 1, (size_t)(p * (double)(samples.size() - 1) + 0.5));
+        return samples[index];
+    };
+
+    return {percentile(0.5), percentile(0.9), percentile(0.99)};
+}
+
+/**
+ * The outcome of a savestate job, shared with its callback so a callback arriving after a timeout has somewhere to write.
+ */
+struct t_st_job_state {
+    std::promise<bool> promise;
+    std::vector<uint8_t> data;
+};
+
+static bool time_st_job(const std::vector<uint8_t>& buffer, const core_st_job job, std::vector<uint8_t>& out, double& ms)
+{
+    const auto state = std::make_shared<t_st_job_state>();
+    auto future = state->promise.get_future();
+
+    const auto begin = std::chrono::high_resolution_clock::now();
+
+    const bool enqueued = core_st_do_memory(buffer, job, [state](const core_st_callback_info& info, const std::vector<uint8_t>& data) {
+        if (info.result == Res_Ok && info.job == core_st_job_save)
+        {
+            state->data = data;
+        }
+        state->promise.set_value(info.result == Res_Ok);
+    },
+                                            true);
+
+    if (!enqueued || future.wait_for(ST_TIMEOUT) != std::future_status::ready)
+    {
+        return false;
+    }
+
+    ms = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - begin).count() / 1000.0;
+
+    if (!future.get())
+    {
+        return false;
+    }
+
+    if (job == core_st_job_save)
+    {
+        out = std::move(state->data);
+    }
+    return true;
+}
+
 void Benchmark::start()
 {
     start_time = std::chrono::high_resolution_clock::now();
@@ -19,13 +84,77 @@ void Benchmark::start()
 void Benchmark::stop(t_result* result)
 {
     const auto now = std::chrono::high_resolution_clock::now();
+    result->core_type = g_config.core.core_type;
     result->fps = (double)frames / ((double)std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_time).count() / 1000000000.0);
+
+    std::vector<core_page_recompiles> pages;
+    core_vr_get_recompile_counts(pages);
+    result->recompiles = 0;
+    for (const auto& page : pages)
+    {
+        result->recompiles += page.recompiles;
+    }
+
+    result->code_cache_flushes = core_vr_get_code_cache_stats().flushes;
+    result->st_allocations = core_st_get_allocation_count();
+
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        result->peak_working_set = counters.PeakWorkingSetSize;
+    }
+}
+
+void Benchmark::measure_savestates(t_result* result, const size_t count)
+{
+    std::vector<double> save_samples;
+    std::vector<double> load_samples;
+    std::vector<uint8_t> buffer;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        double ms{};
+        std::vector<uint8_t> unused;
+
+        if (!time_st_job({}, core_st_job_save, buffer, ms))
+        {
+            g_view_logger->error("[Benchmark] Savestate save timed out or failed, aborting latency measurement");
+            break;
+        }
+        save_samples.push_back(ms);
+
+        if (!time_st_job(buffer, core_st_job_load, unused, ms))
+        {
+            g_view_logger->error("[Benchmark] Savestate load timed out or failed, aborting latency measurement");
+            break;
+        }
+        load_samples.push_back(ms);
+    }
+
+    result->st_save = compute_latency(save_samples);
+    result->st_load = compute_latency(load_samples);
+    result->st_allocations = core_st_get_allocation_count();
 }
 
 void Benchmark::save_result_to_file(const std::filesystem::path& path, const t_result& result)
 {
+    const auto latency_to_json = [](const t_latency& latency) {
+        nlohmann::json j;
+        j["p50"] = latency.p50;
+        j["p90"] = latency.p90;
+        j["p99"] = latency.p99;
+        return j;
+    };
+
     nlohmann::json j;
+    j["core_type"] = result.core_type;
     j["fps"] = result.fps;
+    j["recompiles"] = result.recompiles;
+    j["code_cache_flushes"] = result.code_cache_flushes;
+    j["st_allocations"] = result.st_allocations;
+    j["st_save_ms"] = latency_to_json(result.st_save);
+    j["st_load_ms"] = latency_to_json(result.st_load);
+    j["peak_working_set"] = result.peak_working_set;
 
     std::ofstream of(path);
     of << j.dump(4);
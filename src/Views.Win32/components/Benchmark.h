@@ -12,7 +12,29 @@
 namespace Benchmark
 {
     typedef struct {
+        // The latency percentiles of a savestate operation in milliseconds.
+        double p50;
+        double p90;
+        double p99;
+    } t_latency;
+
+    typedef struct {
+        // The core type the benchmark was run with.
+        int32_t core_type;
+        // The amount of frames (VIs) per second.
         double fps;
+        // The total amount of page recompilations.
+        uint64_t recompiles;
+        // The amount of times the dynarec's code cache was flushed.
+        uint64_t code_cache_flushes;
+        // The amount of savestate buffer allocations.
+        uint64_t st_allocations;
+        // The in-memory savestate save latency.
+        t_latency st_save;
+        // The in-memory savestate load latency.
+        t_latency st_load;
+        // The peak working set size of the process in bytes.
+        uint64_t peak_working_set;
     } t_result;
 
     /**
@@ -25,6 +47,14 @@ namespace Benchmark
      */
     void stop(t_result*);
 
+    /**
+     * \brief Measures the in-memory savestate latency by performing save and load round trips. Writes the result to the provided struct.
+     * \param result The result to write to.
+     * \param count The amount of round trips to perform.
+     * \warning Blocks until all operations complete. Mustn't be called from the emu thread.
+     */
+    void measure_savestates(t_result* result, size_t count);
+
     /**
      * \brief Saves the benchmark result to a file.
      * \param path The path to the file.
@@ -25,6 +25,8 @@ struct t_cli_params {
     std::filesystem::path m64{};
     std::filesystem::path avi{};
     std::filesystem::path benchmark{};
+    int32_t core_type = -1;
+    size_t benchmark_st_count = 100;
     bool close_on_movie_end{};
     bool wait_for_debugger{};
 };
@@ -34,11 +36,29 @@ struct t_cli_state {
     bool is_movie_from_start{};
     size_t dacrate_change_count{};
     bool first_emu_launched = true;
+    // The configured core type, kept while the core type is overridden so the override isn't persisted.
+    std::optional<int32_t> configured_core_type;
 };
 
 static t_cli_params cli_params{};
 static t_cli_state cli_state{};
 
+/**
+ * Parses a numeric CLI option.
+ * \return The option's value, or the default value if the option is missing or malformed.
+ */
+template <typename T>
+static T parse_number(const argh::parser& cmdl, std::initializer_list<const char* const> names, const T def_val)
+{
+    T value{};
+    if (!(cmdl(names, def_val) >> value))
+    {
+        g_view_logger->warn("[CLI] Ignoring malformed value for {}", *names.begin());
+        return def_val;
+    }
+    return value;
+}
+
 static void log_cli_params(const t_cli_params& params)
 {
     g_view_logger->trace("log_cli_params:");
@@ -48,6 +68,8 @@ static void log_cli_params(const t_cli_params& params)
     g_view_logger->trace("  m64: {}", params.m64.string());
     g_view_logger->trace("  avi: {}", params.avi.string());
     g_view_logger->trace("  benchmark: {}", params.benchmark.string());
+    g_view_logger->trace("  core_type: {}", params.core_type);
+    g_view_logger->trace("  benchmark_st_count: {}", params.benchmark_st_count);
     g_view_logger->trace("  close_on_movie_end: {}", params.close_on_movie_end);
     g_view_logger->trace("  wait_for_debugger: {}", params.wait_for_debugger);
 }
@@ -141,8 +163,13 @@ static void on_movie_playback_stop()
     {
         Benchmark::t_result result{};
         Benchmark::stop(&result);
-        Benchmark::save_result_to_file(cli_params.benchmark, result);
-        PostMessage(g_main_hwnd, WM_CLOSE, 0, 0);
+
+        // Savestate jobs complete on the emu thread, so the round trips must be awaited elsewhere.
+        ThreadPool::submit_task([=]() mutable {
+            Benchmark::measure_savestates(&result, cli_params.benchmark_st_count);
+            Benchmark::save_result_to_file(cli_params.benchmark, result);
+            PostMessage(g_main_hwnd, WM_CLOSE, 0, 0);
+        });
     }
 }
 
@@ -227,12 +254,13 @@ void CLI::init()
     cli_params.m64 = cmdl({"--movie", "-m64"}, "").str();
     cli_params.avi = cmdl({"--avi", "-avi"}, "").str();
     cli_params.benchmark = cmdl({"--benchmark", "-b"}, "").str();
+    cli_params.core_type = parse_number<int32_t>(cmdl, {"--core", "-c"}, -1);
+    cli_params.benchmark_st_count = parse_number<size_t>(cmdl, {"--benchmark-st-count"}, 100);
     cli_params.close_on_movie_end = cmdl["--close-on-movie-end"];
     cli_params.wait_for_debugger = cmdl["--wait-for-debugger"] || cmdl["--d"];
     bool compare_control = cmdl["--cmp-ctl"] || cmdl["--compare-control"];
     bool compare_actual = cmdl["--cmp-act"] || cmdl["--compare-actual"];
-    std::string compare_interval_str = cmdl({"--cmp-int", "--compare-interval"}, "100").str();
-    size_t compare_interval = std::stoi(compare_interval_str);
+    size_t compare_interval = parse_number<size_t>(cmdl, {"--cmp-int", "--compare-interval"}, 100);
 
     if (cli_params.wait_for_debugger)
     {
@@ -273,6 +301,19 @@ void CLI::init()
         cli_params.close_on_movie_end = true;
     }
 
+    if (cli_params.core_type != -1)
+    {
+        if (cli_params.core_type < 0 || cli_params.core_type > 2)
+        {
+            DialogService::show_dialog(L"Invalid core type specified in CLI parameters.\nThe configured core type will be used.", L"CLI", fsvc_warning);
+        }
+        else
+        {
+            cli_state.configured_core_type = g_config.core.core_type;
+            g_config.core.core_type = cli_params.core_type;
+        }
+    }
+
     // If an st is specified, a movie mustn't be specified
     if (!cli_params.st.empty() && !cli_params.m64.empty())
     {
@@ -289,7 +330,9 @@ void CLI::init()
     // HACK: When playing a movie from start, the rom will start normally and signal us to do our work via EmuLaunchedChanged.
     // The work is started, but then the rom is reset. At that point, the dacrate changes and breaks the capture in some cases.
     // To avoid this, we store the movie's start flag prior to doing anything, and ignore the first EmuLaunchedChanged if it's set.
-    const auto movie_path = cli_params.rom.extension() == ".m64" ? cli_params.rom : cli_params.m64;
+    cli_state.rom_is_movie = cli_params.rom.extension() == ".m64" || cli_params.rom.extension() == ".m64z";
+
+    const auto movie_path = cli_state.rom_is_movie ? cli_params.rom : cli_params.m64;
     if (!movie_path.empty())
     {
         core_vcr_movie_header hdr{};
@@ -314,11 +357,17 @@ void CLI::init()
         Compare::start(false, compare_interval);
     }
 
-    cli_state.rom_is_movie = cli_params.rom.extension() == ".m64";
-
     log_cli_params(cli_params);
 }
 
+void CLI::revert_overrides(t_config& config)
+{
+    if (cli_state.configured_core_type)
+    {
+        config.core.core_type = *cli_state.configured_core_type;
+    }
+}
+
 bool CLI::wants_fast_forward()
 {
     return !cli_params.avi.empty() || !cli_params.benchmark.empty();
@@ -17,4 +17,10 @@ namespace CLI
      * Gets whether the CLI wants fast-forward to always be enabled.
      */
     bool wants_fast_forward();
+
+    /**
+     * \brief Reverts the config values which were overridden by CLI parameters for the current session to their configured values.
+     * \param config The config to revert the values in.
+     */
+    void revert_overrides(t_config& config);
 } // namespace CLI
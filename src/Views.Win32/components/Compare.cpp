@@ -35,6 +35,10 @@ void Compare::compare(size_t current_sample)
             const auto expected_path = get_saves_directory() / std::format(L"cmp_expected_{}.st", current_sample - compare_interval);
             const auto actual_path = get_saves_directory() / std::format(L"cmp_actual_{}.st", current_sample - compare_interval);
 
+            // Savestates are written in the background, so they might not have landed yet
+            core_st_wait_for_writes(expected_path);
+            core_st_wait_for_writes(actual_path);
+
             if (files_are_equal(expected_path, actual_path))
             {
                 g_view_logger->info("MATCH at frame {}", current_sample - compare_interval);
@@ -1084,12 +1084,19 @@ void get_config_listview_items(std::vector<t_options_group>& groups, std::vector
     t_options_item{
     .group_id = seek_piano_roll_group.id,
     .name = L"Savestate Max Count",
-    .tooltip = L"The maximum amount of savestates to keep in memory for seeking.\nHigher numbers might cause an out of memory exception.",
+    .tooltip = L"The maximum amount of savestates to keep in memory for seeking.\nThe oldest savestates are purged once this amount or the memory limit is exceeded.",
     .data = &g_config.core.seek_savestate_max_count,
     .type = t_options_item::Type::Number,
     },
     t_options_item{
     .group_id = seek_piano_roll_group.id,
+    .name = L"Savestate Memory Limit (MB)",
+    .tooltip = L"The maximum amount of memory the savestates kept for seeking can occupy.\nHigher numbers might cause an out of memory exception.",
+    .data = &g_config.core.seek_savestate_max_resident_mb,
+    .type = t_options_item::Type::Number,
+    },
+    t_options_item{
+    .group_id = seek_piano_roll_group.id,
     .name = L"Constrain edit to column",
     .tooltip = L"Whether piano roll edits are constrained to the column they started on.",
     .data = &g_config.piano_roll_constrain_edit_to_column,
@@ -1256,6 +1263,20 @@ void get_config_listview_items(std::vector<t_options_group>& groups, std::vector
     },
     t_options_item{
     .group_id = core_group.id,
+    .name = L"Save Media Backend",
+    .tooltip = L"How save files are accessed while a ROM is running.\nBuffered - Save data is kept in memory and written back periodically (recommended)\nMemory-mapped - Save files are mapped into memory and flushed by the OS",
+    .data = &g_config.core.save_media_backend,
+    .type = t_options_item::Type::Enum,
+    .possible_values = {
+    std::make_pair(L"Buffered", 0),
+    std::make_pair(L"Memory-mapped", 1),
+    },
+    .is_readonly = [] {
+        return core_vr_get_launched();
+    },
+    },
+    t_options_item{
+    .group_id = core_group.id,
     .name = L"Instant Savestate Update",
     .tooltip = L"Saves and loads game graphics to savestates to allow instant graphics updates when loading savestates.\nGreatly increases savestate saving and loading time.",
     .data = &g_config.core.st_screenshot,
@@ -1271,7 +1292,7 @@ void get_config_listview_items(std::vector<t_options_group>& groups, std::vector
     t_options_item{
     .group_id = core_group.id,
     .name = L"ROM Cache Size",
-    .tooltip = L"Size of the ROM cache.\nImproves ROM loading performance at the cost of data staleness and high memory usage.\n0 - Disabled\nn - Maximum of n ROMs kept in cache",
+    .tooltip = L"Size of the ROM cache.\nStores decompressed and normalized ROMs on disk so they can be launched and reset almost instantly.\n0 - Disabled\nn - Maximum of n ROMs kept in cache",
     .data = &g_config.core.rom_cache_size,
     .type = t_options_item::Type::Number,
     },
@@ -214,8 +214,11 @@ static LRESULT CALLBACK dlgproc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lpara
                 GetDlgItemText(hwnd, IDC_INI_MOVIEFILE, path, std::size(path));
                 user_result.path = path;
 
-                // User might not provide the m64 extension, so just force it to have that
-                user_result.path.replace_extension(".m64");
+                // User might not provide the m64 extension, so just force it to have that unless a compressed movie was requested
+                if (user_result.path.extension() != ".m64z")
+                {
+                    user_result.path.replace_extension(".m64");
+                }
 
                 goto refresh;
             }
@@ -224,11 +227,11 @@ static LRESULT CALLBACK dlgproc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lpara
                 std::wstring path;
                 if (is_readonly)
                 {
-                    path = FilePicker::show_open_dialog(L"o_movie", hwnd, L"*.m64;*.rec");
+                    path = FilePicker::show_open_dialog(L"o_movie", hwnd, L"*.m64;*.m64z;*.rec");
                 }
                 else
                 {
-                    path = FilePicker::show_save_dialog(L"s_movie", hwnd, L"*.m64;*.rec");
+                    path = FilePicker::show_save_dialog(L"s_movie", hwnd, L"*.m64;*.m64z;*.rec");
                 }
 
                 if (path.empty())
@@ -518,6 +518,8 @@
 #define IDR_API_LUA_FILE 40110
 #define IDR_SHIMS_LUA_FILE 40111
 #define IDM_WAIT_AT_MOVIE_END 40112
+#define IDM_BENCHMARK_TRACELOG 40113
+#define IDM_DECODE_TRACELOG 40114
 #define IDC_STATIC -1
 
 // Next default values for new objects
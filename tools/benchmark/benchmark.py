@@ -23,6 +23,22 @@ CONFIG_INI_PATH = "../../build/Views.Win32/config.ini"
 STANDARD_ARGS = [  '-g', "..\\roms\\m64p_test_rom.v64", '-m64', 'test_rom_benchmark.m64' ]
 BUILD_COMMAND = 'msbuild mupen64.sln /p:Configuration=Release /p:Platform=x86 /m /verbosity:quiet -nologo'
 FPS_PERCENTAGE_EPSILON = 1
+CORE_TYPES = { 0: "interpreter", 1: "dynarec", 2: "pure-interpreter" }
+
+# The metrics to compare and whether a higher value is better.
+METRICS = {
+    'fps': True,
+    'recompiles': False,
+    'code_cache_flushes': False,
+    'st_allocations': False,
+    'st_save_ms.p50': False,
+    'st_save_ms.p90': False,
+    'st_save_ms.p99': False,
+    'st_load_ms.p50': False,
+    'st_load_ms.p90': False,
+    'st_load_ms.p99': False,
+    'peak_working_set': False,
+}
 WARMUP_RUN_COUNT = 3
 NORMAL_RUN_COUNT = 6
 
@@ -44,6 +60,16 @@ def fill_commit_hashes():
     if not new_commit_hash:
         new_commit_hash = subprocess.run(['git', 'rev-parse', '--short', 'HEAD'], capture_output=True, text=True, check=True).stdout.strip()
 
+def get_metric(data, key):
+    '''
+    Gets a metric from a benchmark result, or None if the result doesn't contain it (e.g. because it was produced by an older build).
+    '''
+    for part in key.split('.'):
+        if not isinstance(data, dict) or part not in data:
+            return None
+        data = data[part]
+    return data
+
 def run_mupen(name, additional_args):
     benchmark_path = f"benchmark_{name}.json"
 
@@ -51,18 +77,22 @@ def run_mupen(name, additional_args):
 
     print(f"Running {' '.join(args)}")
     
-    fps_sum = 0
+    sums = { key: 0 for key in METRICS }
+    missing = set()
 
     for i in range(WARMUP_RUN_COUNT + NORMAL_RUN_COUNT):
         subprocess.run(args, timeout=120)
-        if i > WARMUP_RUN_COUNT:
+        if i >= WARMUP_RUN_COUNT:
             with open(benchmark_path) as f:
                 data = json.load(f)
-                fps_sum += data['fps']
+                for key in METRICS:
+                    value = get_metric(data, key)
+                    if value is None:
+                        missing.add(key)
+                    else:
+                        sums[key] += value
     
-    fps_avg = fps_sum / NORMAL_RUN_COUNT
-    
-    return { 'fps': fps_avg } 
+    return { key: value / NORMAL_RUN_COUNT for key, value in sums.items() if key not in missing }
 
 def run_benchmark_full(name, additional_args=[]):
     subprocess.run(['git', 'stash', 'push', '-u', '-m', 'benchmark'], stderr=subprocess.DEVNULL, stdout=subprocess.DEVNULL)
@@ -89,19 +119,23 @@ def run_benchmark_full(name, additional_args=[]):
     
     subprocess.run(['git', 'stash', 'pop'], stderr=subprocess.DEVNULL, stdout=subprocess.DEVNULL)
 
-    new_fps = benchmark_new['fps']
-    old_fps = benchmark_old['fps']
-    delta = new_fps - old_fps
-    percentage_change = (delta / old_fps) * 100
-    within_margin_of_error = abs(percentage_change) < FPS_PERCENTAGE_EPSILON
-
     print(f"Benchmark - {name} ({old_commit_hash}) vs {new_commit_hash}")
-    print(f"FPS: {old_fps:.2f} (old) | {new_fps:.2f} (new)")
-    print(f"Change: {percentage_change:.2f}%")
-    if within_margin_of_error:
-        print("Within margin of error.")
-    else:
-        print(percentage_change > 0 and "IMPROVEMENT" or "REGRESSION")
+    for key, higher_is_better in METRICS.items():
+        if key not in benchmark_new or key not in benchmark_old:
+            print(f"{key}: not reported by both commits, skipped")
+            continue
+
+        new_value = benchmark_new[key]
+        old_value = benchmark_old[key]
+        delta = new_value - old_value
+        percentage_change = (delta / old_value) * 100 if old_value else 0
+        within_margin_of_error = abs(percentage_change) < FPS_PERCENTAGE_EPSILON
+
+        verdict = "within margin of error"
+        if not within_margin_of_error:
+            verdict = (percentage_change > 0) == higher_is_better and "IMPROVEMENT" or "REGRESSION"
+
+        print(f"{key}: {old_value:.2f} (old) | {new_value:.2f} (new) | {percentage_change:.2f}% ({verdict})")
     print("------")
 
 def create_config():
@@ -131,7 +165,8 @@ def main():
     fill_commit_hashes()
 
     print(f"Running benchmarks for {old_commit_hash} vs {new_commit_hash}...")
-    run_benchmark_full("normal")
+    for core_type, core_name in CORE_TYPES.items():
+        run_benchmark_full(f"normal-{core_name}", ["--core", str(core_type)])
     run_benchmark_full("with-dummy-lua", ["-lua", "dummy.lua"])
     
     # TODO: Add more benchmarks here.  